@@ -0,0 +1,104 @@
+#!/bin/sh
+
+TMP=${TMP:=/tmp/bench}			# chemin des fichiers temporaires
+
+#
+# Banc d'essai commun à tous les outils (make bench) :
+# - chaque profil d'optimisation est construit par "make profil" dans
+#   _bench/<profil> ; pgo est entraîné sur les mêmes charges ;
+# - chaque charge type est exécutée par ./mesure, qui relève temps écoulé,
+#   mémoire résidente maximale et compteurs matériels ;
+# - le résultat est un tableau unique séparé par tabulations.
+# Utilisation : sh ./bench.sh (ou make bench)
+#
+# Variables modifiables :
+#	PROFILS	liste des profils (O0 O2 O3 lto pgo)
+#	OUTILS	liste des outils mesurés ("ronde" exécute rondeur, la
+#		version corrigée de ronde.c)
+#	REP	nombre d'exécutions par mesure (la meilleure est retenue)
+#
+
+set -u					# erreur si variable non définie
+
+PROFILS=${PROFILS:="O0 O2 O3 lto pgo"}
+OUTILS=${OUTILS:="infos majus rotation prodscal poly ronde sig"}
+REP=${REP:=3}
+
+# arborescence pour infos et majus, fichier pour rotation
+preparer ()
+{
+    rm -rf $TMP.arbre $TMP.maj
+    for d in $(seq 1 30)
+    do
+	mkdir -p $TMP.arbre/r$d/s
+	for f in $(seq 1 25)
+	do
+	    seq 1 $f > $TMP.arbre/r$d/f$f
+	    echo "fichier $d $f" > $TMP.arbre/r$d/s/g$f
+	done
+    done
+    head -c 16777216 /dev/zero | tr '\0' 'x' > $TMP.rot
+    VECTEUR=$(seq 1 4000 | tr '\n' ' ')
+}
+
+# $1 = répertoire des exécutables, $2 = outil : affiche la commande
+commande ()
+{
+    case "$2" in
+	infos)    echo "$1/infos $TMP.arbre" ;;
+	majus)    echo "$1/majus $TMP.arbre $TMP.maj" ;;
+	rotation) echo "$1/rotation 1000 $TMP.rot" ;;
+	prodscal) echo "$1/prodscal 4 $VECTEUR $VECTEUR" ;;
+	poly)     echo "$1/poly -H -m -n futex 2000 $TMP.poly 0 0 0 0 0 0 0 0" ;;
+	ronde)    echo "$1/rondeur $TMP.ronde $(seq 1 64 | tr '\n' ' ')" ;;
+	sig)      echo "$1/sig -q 0.3" ;;
+	*)        echo "outil inconnu : $2" >&2 ; exit 1 ;;
+    esac
+}
+
+# $1 = outil : préparation avant chaque exécution, hors mesure
+avant ()
+{
+    case "$1" in
+	majus) echo "rm -rf $TMP.maj" ;;
+	*)     echo "true" ;;
+    esac
+}
+
+# $1 = profil
+construire ()
+{
+    if [ "$1" = pgo ]
+    then
+	# entraînement : exécuter une fois chaque charge instrumentée
+	rm -rf _bench/gcda
+	make -s profil PROFIL=pgo PGO=generate > /dev/null || exit 1
+	for o in $OUTILS
+	do
+	    eval "$(avant $o) && $(commande _bench/pgo $o)" > /dev/null 2>&1 \
+		|| { echo "échec de l'entraînement de $o" >&2 ; exit 1 ; }
+	done
+	make -s profil PROFIL=pgo PGO=use > /dev/null || exit 1
+    else
+	make -s profil PROFIL=$1 > /dev/null || exit 1
+    fi
+}
+
+[ -x ./mesure ] || make -s mesure || exit 1
+preparer
+
+printf "profil\toutil\tmur_ms\trss_kio\tcycles\tinstructions"
+printf "\tdefauts_cache\tchangements\tipc\n"
+for p in $PROFILS
+do
+    construire $p
+    for o in $OUTILS
+    do
+	eval "./mesure -r $REP -a '$(avant $o)' -e '$p	$o'" \
+	     "$(commande _bench/$p $o)" \
+	    || { echo "échec : $p $o" >&2 ; exit 1 ; }
+    done
+done
+
+rm -rf $TMP.arbre $TMP.maj $TMP.rot $TMP.rot.rot $TMP.poly $TMP.ronde
+exit 0
@@ -0,0 +1,81 @@
+#!/bin/sh
+
+PROG=${PROG:=./prodscal}		# chemin de l'exécutable
+
+#
+# Banc d'essai de l'exercice 4 : compare les transports du moteur
+# map-reduce (option -m) : processus et tubes, processus et mémoire
+# partagée, threads
+# Utilisation : sh ./bench4.sh
+#
+# Variables modifiables :
+#	TAILLES	liste des tailles de vecteurs
+#	NBPROC	liste des valeurs de c
+#	REP	nombre d'exécutions par mesure
+#	TRANSPORTS liste des transports comparés
+#
+# Affiche une ligne par couple (n, c) avec la durée moyenne d'une
+# exécution en microsecondes pour chaque transport.
+#
+
+set -u					# erreur si variable non définie
+
+TAILLES=${TAILLES:="10 100 1000 10000"}
+NBPROC=${NBPROC:="1 2 4 8 16"}
+REP=${REP:=20}
+TRANSPORTS=${TRANSPORTS:="tube shm threads"}
+
+# date courante en nanosecondes
+maintenant ()
+{
+    date +%s%N
+}
+
+# durée moyenne (en µs) de REP exécutions de la commande
+# $@ = commande à exécuter
+mesurer ()
+{
+    local debut fin i
+    debut=$(maintenant)
+    i=0
+    while [ $i -lt $REP ]
+    do
+	"$@" > /dev/null || { echo "échec : $1" >&2 ; exit 1 ; }
+	i=$((i+1))
+    done
+    fin=$(maintenant)
+    echo $(( (fin - debut) / 1000 / REP ))
+}
+
+if [ ! -x "$PROG" ]
+then
+    echo "Exécutable '$PROG' non trouvé" >&2
+    exit 1
+fi
+
+printf "%8s %4s" n c
+for m in $TRANSPORTS
+do
+    printf " %10s" "$m(µs)"
+done
+printf " %8s\n" gagnant
+for n in $TAILLES
+do
+    X=$(seq 1 $n)
+    Y=$(seq $n -1 1)
+    for c in $NBPROC
+    do
+	printf "%8d %4d" $n $c
+	g= ; tg=
+	for m in $TRANSPORTS
+	do
+	    t=$(mesurer $PROG -m $m $c $X $Y)
+	    printf " %10d" $t
+	    if [ -z "$tg" ] || [ $t -lt $tg ]
+	    then g=$m ; tg=$t
+	    fi
+	done
+	printf " %8s\n" $g
+    done
+done
+exit 0
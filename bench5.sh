@@ -0,0 +1,110 @@
+#!/bin/sh
+
+PROG=${PROG:=./poly}			# chemin de l'exécutable
+
+TMP=${TMP:=/tmp/bench}			# chemin des fichiers temporaires
+
+#
+# Banc d'essai de l'exercice 5 :
+# - latence d'un saut dans l'anneau selon le mécanisme de notification
+#   (signal, eventfd, futex, futex avec attente active) ;
+# - débit (valeurs de x par seconde) selon la profondeur du pipeline ;
+# - débit de l'évaluation par Horner et par différences finies (-d)
+#   selon le degré ;
+# - débit (valeurs de x par seconde) du mode par lots (-b) selon la
+#   taille du lot et le degré
+# Utilisation : sh ./bench5.sh
+#
+# Variables modifiables :
+#	ANNEAUX	liste des tailles d'anneau (nb de processus, père compris)
+#	K	nombre de tours d'anneau (valeurs de x)
+#	SPIN	nb d'itérations d'attente active pour "futex+spin"
+#	PROFS	liste des profondeurs de pipeline (1 = un seul x en vol)
+#	DEGRES	liste des degrés pour la comparaison Horner / différences
+#		et pour le mode par lots
+#	LOTS	liste des tailles de lot (1 = un x par tour d'anneau)
+#
+# L'évaluation est native (-H) et l'état en mémoire partagée (-m) pour
+# ne mesurer que la notification. Les coefficients sont nuls pour
+# éviter tout débordement.
+#
+
+set -u					# erreur si variable non définie
+
+ANNEAUX=${ANNEAUX:="2 4 8 16 32 64 128 256"}
+K=${K:=200}
+SPIN=${SPIN:=1000}
+PROFS=${PROFS:="1 2 4 8 16"}
+DEGRES=${DEGRES:="1 2 4 8 16 32"}
+LOTS=${LOTS:="1 4 8 16 32 64"}
+
+# $1 = taille de l'anneau, $2 et suivants = options de notification
+mesurer ()
+{
+    local r="$1"
+    shift
+    $PROG -H -m -t "$@" $K $TMP.poly $(seq 2 $r | sed 's/.*/0/') \
+		> /dev/null 2> $TMP.err \
+	|| { echo "échec : $PROG $*" >&2 ; cat $TMP.err >&2 ; exit 1 ; }
+    # "R processus, S sauts, N ns/saut, H sauts/s, V valeurs/s"
+    sed -n 's/.* sauts, \([0-9]*\) ns\/saut, \([0-9]*\) sauts\/s, \([0-9]*\) valeurs\/s/\1 \2 \3/p' \
+		$TMP.err
+}
+
+if [ ! -x "$PROG" ]
+then
+    echo "Exécutable '$PROG' non trouvé" >&2
+    exit 1
+fi
+
+printf "%8s %-12s %10s %12s\n" processus notification ns/saut sauts/s
+for r in $ANNEAUX
+do
+    for mode in signal eventfd futex futex+spin
+    do
+	case $mode in
+	    futex+spin) res=$(mesurer $r -n futex -s $SPIN) ;;
+	    *)		res=$(mesurer $r -n $mode) ;;
+	esac
+	set -- $res
+	printf "%8d %-12s %10d %12d\n" $r $mode $1 $2
+    done
+done
+
+echo
+printf "%8s %10s %10s %12s\n" processus profondeur ns/saut points/s
+for r in $ANNEAUX
+do
+    for p in $PROFS
+    do
+	set -- $(mesurer $r -p $p)
+	printf "%8d %10d %10d %12d\n" $r $p $1 $(($2 / r))
+    done
+done
+
+echo
+printf "%6s %-12s %10s %12s\n" degré évaluation ns/saut valeurs/s
+for d in $DEGRES
+do
+    for mode in horner differences
+    do
+	case $mode in
+	    horner)	res=$(mesurer $((d + 2)) -n futex) ;;
+	    differences) res=$(mesurer $((d + 2)) -n futex -d) ;;
+	esac
+	set -- $res
+	printf "%6d %-12s %10d %12d\n" $d $mode $1 $3
+    done
+done
+echo
+printf "%6s %6s %10s %12s\n" degré lot ns/saut points/s
+for d in $DEGRES
+do
+    for b in $LOTS
+    do
+	set -- $(mesurer $((d + 2)) -n futex -b $b)
+	printf "%6d %6d %10d %12d\n" $d $b $1 $3
+    done
+done
+rm -f $TMP*
+exit 0
@@ -0,0 +1,289 @@
+#include <errno.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdnoreturn.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "collectif.h"
+
+#define USAGE "usage: bench_collectif [-n nproc] [-i iter] [-t max] [-s spin]"
+
+#define ECH_MAX (16 << 20) // n * taille maximal pour l'échange total
+
+#define CHK(op)                                                                \
+    do {                                                                       \
+        if ((op) == -1)                                                        \
+            raler(1, #op);                                                     \
+    } while (0)
+
+#define CHKN(op)                                                               \
+    do {                                                                       \
+        if ((op) == NULL)                                                      \
+            raler(1, #op);                                                     \
+    } while (0)
+
+noreturn void raler(int syserr, const char *fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    vfprintf(stderr, fmt, ap);
+    fprintf(stderr, "\n");
+    va_end(ap);
+    if (syserr)
+        perror("");
+    exit(1);
+}
+
+enum collective { BARRIERE, DECALER, DIFFUSER, REDUIRE, COLLECTER, ECHANGER };
+
+static const char *noms[] = {"barriere",  "decaler",   "diffuser",
+                             "reduire",   "collecter", "echange_total"};
+
+// algorithmes comparés : auto, anneau et la variante logarithmique
+static int algos(enum collective col, enum coll_algo a[]) {
+    a[0] = COLL_AUTO;
+    if (col == DECALER || col == BARRIERE)
+        return 1;
+    a[1] = COLL_ANNEAU;
+    a[2] = col == COLLECTER || col == ECHANGER ? COLL_DOUBLEMENT : COLL_ARBRE;
+    return 3;
+}
+
+static unsigned char octet(int r, int d, size_t j) {
+    return (unsigned char)(r * 7 + d * 13 + j);
+}
+
+static int64_t valeur(int r, size_t i) { return (int64_t)r * 1000003 + i; }
+
+struct tampons {
+    unsigned char *env, *rec;
+};
+
+// remplit env selon la collective, pour ensuite vérifier rec
+static void preparer(struct coll *c, enum collective col, struct tampons *t,
+                     size_t taille) {
+    int n = c->n, r = c->rang;
+    int64_t *v = (int64_t *)t->env;
+
+    switch (col) {
+    case BARRIERE:
+        break;
+    case DECALER:
+    case COLLECTER:
+        for (size_t j = 0; j < taille; j++)
+            t->env[j] = octet(r, 0, j);
+        break;
+    case DIFFUSER:
+        for (size_t j = 0; j < taille; j++)
+            t->rec[j] = r == 0 ? octet(0, 0, j) : 0;
+        break;
+    case REDUIRE:
+        for (size_t i = 0; i < taille / sizeof(int64_t); i++)
+            v[i] = valeur(r, i);
+        break;
+    case ECHANGER:
+        for (int d = 0; d < n; d++)
+            for (size_t j = 0; j < taille; j++)
+                t->env[d * taille + j] = octet(r, d, j);
+        break;
+    }
+}
+
+static void executer(struct coll *c, enum collective col, struct tampons *t,
+                     size_t taille) {
+    switch (col) {
+    case BARRIERE:
+        coll_barriere(c);
+        break;
+    case DECALER:
+        coll_decaler(c, t->env, t->rec, taille);
+        break;
+    case DIFFUSER:
+        coll_diffuser(c, t->rec, taille, 0);
+        break;
+    case REDUIRE:
+        coll_reduire(c, (int64_t *)t->env, (int64_t *)t->rec,
+                     taille / sizeof(int64_t), COLL_SOMME, 0);
+        break;
+    case COLLECTER:
+        coll_collecter(c, t->env, t->rec, taille);
+        break;
+    case ECHANGER:
+        coll_echange_total(c, t->env, t->rec, taille);
+        break;
+    }
+}
+
+static void verifier(struct coll *c, enum collective col, struct tampons *t,
+                     size_t taille) {
+    int n = c->n, r = c->rang;
+    int64_t *v = (int64_t *)t->rec;
+    int64_t attendu;
+
+    switch (col) {
+    case BARRIERE:
+        return;
+    case DECALER:
+        for (size_t j = 0; j < taille; j++)
+            if (t->rec[j] != octet((r - 1 + n) % n, 0, j))
+                goto erreur;
+        break;
+    case DIFFUSER:
+        for (size_t j = 0; j < taille; j++)
+            if (t->rec[j] != octet(0, 0, j))
+                goto erreur;
+        break;
+    case REDUIRE:
+        if (r != 0)
+            return;
+        for (size_t i = 0; i < taille / sizeof(int64_t); i++) {
+            attendu = (int64_t)n * i + (int64_t)1000003 * n * (n - 1) / 2;
+            if (v[i] != attendu)
+                goto erreur;
+        }
+        break;
+    case COLLECTER:
+        for (int s = 0; s < n; s++)
+            for (size_t j = 0; j < taille; j++)
+                if (t->rec[s * taille + j] != octet(s, 0, j))
+                    goto erreur;
+        break;
+    case ECHANGER:
+        for (int s = 0; s < n; s++)
+            for (size_t j = 0; j < taille; j++)
+                if (t->rec[s * taille + j] != octet(s, r, j))
+                    goto erreur;
+        break;
+    }
+    return;
+
+erreur:
+    raler(0, "%s (%s, %zu octets) : résultat faux au rang %d", noms[col],
+          coll_nom_algo(c->algo), taille, r);
+}
+
+static double maintenant_us(void) {
+    struct timespec ts;
+    CHK(clock_gettime(CLOCK_MONOTONIC, &ts));
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+// une mesure : vérification, puis iter répétitions entre deux barrières
+static void mesurer(struct coll *c, enum collective col, struct tampons *t,
+                    size_t taille, int iter) {
+    double debut, fin;
+
+    preparer(c, col, t, taille);
+    executer(c, col, t, taille);
+    verifier(c, col, t, taille);
+
+    coll_barriere(c);
+    debut = maintenant_us();
+    for (int i = 0; i < iter; i++)
+        executer(c, col, t, taille);
+    coll_barriere(c);
+    fin = maintenant_us();
+
+    if (c->rang == 0)
+        printf("%s\t%s\t%d\t%zu\t%.2f\n", noms[col], coll_nom_algo(c->algo),
+               c->n, taille, (fin - debut) / iter);
+}
+
+static void rang(struct coll *c, int r, int iter, size_t max) {
+    struct tampons t;
+    enum coll_algo a[3];
+    int na;
+    size_t taille_max = (size_t)c->n * max;
+
+    coll_rejoindre(c, r);
+    CHKN(t.env = malloc(taille_max));
+    CHKN(t.rec = malloc(taille_max));
+
+    c->algo = COLL_AUTO;
+    mesurer(c, BARRIERE, &t, 0, iter);
+    for (enum collective col = DECALER; col <= ECHANGER; col++) {
+        na = algos(col, a);
+        for (int i = 0; i < na; i++) {
+            c->algo = a[i];
+            for (size_t taille = 8; taille <= max; taille *= 2) {
+                if (col == ECHANGER && c->n * taille > ECH_MAX)
+                    break;
+                mesurer(c, col, &t, taille, iter);
+            }
+        }
+    }
+    CHK(fflush(stdout) == EOF ? -1 : 0);
+
+    free(t.env);
+    free(t.rec);
+    coll_detruire(c);
+}
+
+static long lire_entier(const char *s, long min) {
+    char *fin;
+    long v;
+
+    errno = 0;
+    v = strtol(s, &fin, 10);
+    if (errno != 0 || *fin != '\0' || fin == s || v < min)
+        raler(0, USAGE);
+    return v;
+}
+
+int main(int argc, char *argv[]) {
+    struct coll c;
+    int n = 4, iter = 20, spin = 0, opt, raison, code = 0;
+    size_t max = 1 << 20;
+
+    while ((opt = getopt(argc, argv, "n:i:t:s:")) != -1) {
+        switch (opt) {
+        case 'n':
+            n = lire_entier(optarg, 1);
+            break;
+        case 'i':
+            iter = lire_entier(optarg, 1);
+            break;
+        case 't':
+            max = lire_entier(optarg, 8);
+            break;
+        case 's':
+            spin = lire_entier(optarg, 0);
+            break;
+        default:
+            raler(0, USAGE);
+        }
+    }
+    if (optind != argc)
+        raler(0, USAGE);
+
+    CHK(coll_init(&c, n));
+    c.attente = spin;
+    printf("collective\talgo\tn\toctets\tus\n");
+    CHK(fflush(stdout) == EOF ? -1 : 0);
+
+    for (int r = 0; r < n; r++) {
+        switch (fork()) {
+        case -1:
+            raler(1, "fork");
+        case 0:
+            rang(&c, r, iter, max);
+            exit(0);
+        default:
+            break;
+        }
+    }
+
+    for (int r = 0; r < n; r++) {
+        CHK(wait(&raison));
+        if (!WIFEXITED(raison) || WEXITSTATUS(raison) != 0)
+            code = 1;
+    }
+    coll_detruire(&c);
+
+    return code;
+}
@@ -0,0 +1,145 @@
+#include <errno.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdnoreturn.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "lancement.h"
+
+#define USAGE "usage: bench_lancement [-n iter] [-m Mio] [commande ...]"
+
+#define MIO (1024 * 1024)
+
+#define CHK(op)                                                                \
+    do {                                                                       \
+        if ((op) == -1)                                                        \
+            raler(1, #op);                                                     \
+    } while (0)
+
+noreturn void raler(int syserr, const char *fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    vfprintf(stderr, fmt, ap);
+    fprintf(stderr, "\n");
+    va_end(ap);
+    if (syserr)
+        perror("");
+    exit(1);
+}
+
+static const char *modes[] = {"fork", "vfork", "spawn", "clone", "pool"};
+
+static double maintenant_us(void) {
+    struct timespec ts;
+    CHK(clock_gettime(CLOCK_MONOTONIC, &ts));
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static void attendre_ok(void) {
+    int raison;
+
+    CHK(lance_attendre(&raison));
+    if (!(WIFEXITED(raison) && WEXITSTATUS(raison) == 0))
+        raler(0, "commande mal terminée (%s)", lance_nom());
+}
+
+// temps moyen d'un lancement suivi de son attente
+static double mesurer_exec(char *const cmd[], int iter) {
+    double debut;
+
+    if (lance_exec(cmd, -1, -1) == -1) // échauffement
+        raler(1, "%s (%s)", cmd[0], lance_nom());
+    attendre_ok();
+
+    debut = maintenant_us();
+    for (int i = 0; i < iter; i++) {
+        if (lance_exec(cmd, -1, -1) == -1)
+            raler(1, "%s (%s)", cmd[0], lance_nom());
+        attendre_ok();
+    }
+    return (maintenant_us() - debut) / iter;
+}
+
+// référence : un fils qui exécute du code du programme, sans exec
+static double mesurer_fork(int iter) {
+    double debut = maintenant_us();
+
+    for (int i = 0; i < iter; i++) {
+        switch (lance_fork()) {
+        case -1:
+            raler(1, "fork");
+        case 0:
+            _exit(0);
+        default:
+            attendre_ok();
+        }
+    }
+    return (maintenant_us() - debut) / iter;
+}
+
+int main(int argc, char *argv[]) {
+    char *defaut[] = {"true", NULL};
+    char *const *cmd = defaut;
+    int iter = 200, max = 256, opt;
+    char *lest = NULL;
+    size_t taille = 0;
+
+    while ((opt = getopt(argc, argv, "+n:m:")) != -1) {
+        switch (opt) {
+        case 'n':
+            iter = atoi(optarg);
+            break;
+        case 'm':
+            max = atoi(optarg);
+            break;
+        default:
+            raler(0, USAGE);
+        }
+    }
+    if (iter <= 0 || max < 0)
+        raler(0, USAGE);
+    if (optind < argc)
+        cmd = argv + optind;
+
+    /*
+     * Le père grossit d'une taille à l'autre : fork recopie ses tables
+     * de pages, les autres modes non. Les serveurs du pool sont créés
+     * d'emblée, quand le père est encore petit.
+     */
+    if (lance_choisir("pool") == -1)
+        raler(0, "mode pool");
+    lance_init();
+    printf("mode\tMio\tus\n");
+    for (int m = 0; m <= max; m = m == 0 ? 16 : 4 * m) {
+        if (lest != NULL)
+            CHK(munmap(lest, taille));
+        taille = (size_t)m * MIO;
+        lest = NULL;
+        if (taille > 0) {
+            lest = mmap(NULL, taille, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (lest == MAP_FAILED)
+                raler(1, "mmap %d Mio", m);
+            memset(lest, 1, taille); // pages réellement présentes
+        }
+
+        for (size_t i = 0; i < sizeof modes / sizeof modes[0]; i++) {
+            if (lance_choisir(modes[i]) == -1)
+                raler(0, "mode %s", modes[i]);
+            printf("%s\t%d\t%.1f\n", modes[i], m, mesurer_exec(cmd, iter));
+            CHK(fflush(stdout) == EOF ? -1 : 0);
+        }
+        lance_choisir("fork");
+        printf("fork-fils\t%d\t%.1f\n", m, mesurer_fork(iter));
+        CHK(fflush(stdout) == EOF ? -1 : 0);
+    }
+
+    if (lest != NULL)
+        CHK(munmap(lest, taille));
+    exit(0);
+}
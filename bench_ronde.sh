@@ -0,0 +1,66 @@
+#!/bin/sh
+
+PROG=${PROG:=./rondeur}			# chemin de l'exécutable
+
+TMP=${TMP:=/tmp/bench}			# chemin des fichiers temporaires
+
+#
+# Banc d'essai de la ronde : durée d'un tour (démarrage, échange des
+# valeurs et fin) selon le nombre de processus et la méthode de
+# démarrage (un kill par fils, kill de groupe, barrière futex)
+# Utilisation : sh ./bench_ronde.sh
+#
+# Variables modifiables :
+#	TAILLES	liste des nombres de processus
+#	REP	nombre de tours mesurés par point (on garde le meilleur)
+#
+# Le tour est mesuré par le programme lui-même (option -t) : du
+# démarrage jusqu'à la barrière de fin (-d barriere) ou jusqu'à la
+# terminaison du dernier fils (autres méthodes).
+#
+
+set -u					# erreur si variable non définie
+
+TAILLES=${TAILLES:="2 4 8 16 32 64 128 256 512 1024 2048 4096"}
+REP=${REP:=5}
+
+# meilleure durée (en µs) sur REP tours
+# $1 = nb de processus, $2 et suivants = options
+mesurer ()
+{
+    local n="$1" meilleur=0 t i
+    shift
+    i=0
+    while [ $i -lt $REP ]
+    do
+	$PROG "$@" -t $TMP.ronde $(seq 1 $n) > /dev/null 2> $TMP.err \
+	    || { echo "échec : $PROG $*" >&2 ; cat $TMP.err >&2 ; exit 1 ; }
+	t=$(sed -n 's/.*tour en \([0-9]*\) ns/\1/p' $TMP.err)
+	t=$((t / 1000))
+	if [ $meilleur = 0 -o $t -lt $meilleur ]
+	then meilleur=$t
+	fi
+	i=$((i+1))
+    done
+    echo $meilleur
+}
+
+if [ ! -x "$PROG" ]
+then
+    echo "Exécutable '$PROG' non trouvé" >&2
+    exit 1
+fi
+
+printf "%6s %10s %10s %10s %10s %10s   (µs)\n" \
+	n kill groupe kill-m groupe-m barriere
+for n in $TAILLES
+do
+    printf "%6d %10d %10d %10d %10d %10d\n" $n \
+	$(mesurer $n -d kill) \
+	$(mesurer $n -d groupe) \
+	$(mesurer $n -m -d kill) \
+	$(mesurer $n -m -d groupe) \
+	$(mesurer $n -d barriere)
+done
+rm -f $TMP*
+exit 0
@@ -0,0 +1,380 @@
+#include <errno.h>
+#include <limits.h>
+#include <linux/futex.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "collectif.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define PAUSE() __builtin_ia32_pause()
+#else
+#define PAUSE() ((void)0)
+#endif
+
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+
+/*
+ * Boîte aux lettres de src vers dst : file circulaire de COLL_PROF
+ * segments. Seul src écrit "deposes", seul dst écrit "retraits" ; chacun
+ * ne fait l'appel système de réveil que si l'autre dort.
+ */
+struct coll_boite {
+    _Alignas(64) atomic_uint deposes; // nb de segments déposés
+    atomic_uint dort_rec;             // dst bloqué sur deposes
+    _Alignas(64) atomic_uint retraits; // nb de segments retirés
+    atomic_uint dort_env;              // src bloqué sur retraits
+    _Alignas(64) char seg[COLL_PROF][COLL_SEGMENT];
+};
+
+#define PAS_DE_COMBINAISON -1
+
+static struct coll_boite *boite(struct coll *c, int src, int dst) {
+    return &c->b[(size_t)src * c->n + dst];
+}
+
+static size_t nb_segments(size_t taille) {
+    // un message vide occupe tout de même un segment (jeton)
+    return taille == 0 ? 1 : (taille + COLL_SEGMENT - 1) / COLL_SEGMENT;
+}
+
+// attend que *mot ne vaille plus v
+static void attendre(struct coll *c, atomic_uint *mot, unsigned v,
+                     atomic_uint *dort) {
+    for (int t = 0; t < c->attente && atomic_load(mot) == v; t++)
+        PAUSE();
+    while (atomic_load(mot) == v) {
+        atomic_store(dort, 1);
+        if (syscall(SYS_futex, mot, FUTEX_WAIT, v, NULL, NULL, 0) == -1 &&
+            errno != EAGAIN && errno != EINTR)
+            raler(1, "futex");
+        atomic_store(dort, 0);
+    }
+}
+
+static void avancer(atomic_uint *mot, atomic_uint *dort) {
+    // seq_cst : symétrique de l'écriture de "dort" dans attendre()
+    atomic_fetch_add(mot, 1);
+    if (atomic_load(dort))
+        syscall(SYS_futex, mot, FUTEX_WAKE, 1, NULL, NULL, 0);
+}
+
+static void deposer(struct coll *c, struct coll_boite *b, const char *src,
+                    size_t t) {
+    unsigned d = atomic_load_explicit(&b->deposes, memory_order_relaxed);
+    unsigned r;
+
+    while (d - (r = atomic_load(&b->retraits)) >= COLL_PROF)
+        attendre(c, &b->retraits, r, &b->dort_env);
+    memcpy(b->seg[d % COLL_PROF], src, t);
+    avancer(&b->deposes, &b->dort_rec);
+}
+
+static void combiner(int64_t *acc, const int64_t *v, size_t nb, int op) {
+    switch (op) {
+    case COLL_SOMME:
+        for (size_t i = 0; i < nb; i++)
+            acc[i] += v[i];
+        break;
+    case COLL_MIN:
+        for (size_t i = 0; i < nb; i++)
+            acc[i] = MIN(acc[i], v[i]);
+        break;
+    case COLL_MAX:
+        for (size_t i = 0; i < nb; i++)
+            acc[i] = acc[i] > v[i] ? acc[i] : v[i];
+        break;
+    }
+}
+
+// retire un segment vers dst, ou le combine avec dst si op >= 0
+static void retirer(struct coll *c, struct coll_boite *b, char *dst, size_t t,
+                    int op) {
+    unsigned r = atomic_load_explicit(&b->retraits, memory_order_relaxed);
+    unsigned d;
+    int64_t seg[COLL_SEGMENT / sizeof(int64_t)];
+
+    while ((d = atomic_load(&b->deposes)) == r)
+        attendre(c, &b->deposes, d, &b->dort_rec);
+    if (op == PAS_DE_COMBINAISON) {
+        memcpy(dst, b->seg[r % COLL_PROF], t);
+    } else {
+        // dst n'est pas forcément aligné sur 8 octets
+        int64_t acc[COLL_SEGMENT / sizeof(int64_t)];
+        memcpy(seg, b->seg[r % COLL_PROF], t);
+        memcpy(acc, dst, t);
+        combiner(acc, seg, t / sizeof(int64_t), op);
+        memcpy(dst, acc, t);
+    }
+    avancer(&b->retraits, &b->dort_env);
+}
+
+/*
+ * Envoi et réception entrelacés segment par segment : comme chaque
+ * boîte peut contenir au moins un segment, un cycle de processus qui
+ * échangent simultanément ne peut pas se bloquer. dst ou src à -1 :
+ * pas d'envoi ou pas de réception.
+ */
+static void echanger(struct coll *c, int dst, const char *env, size_t tenv,
+                     int src, char *rec, size_t trec, int op) {
+    size_t se = dst < 0 ? 0 : nb_segments(tenv);
+    size_t sr = src < 0 ? 0 : nb_segments(trec);
+    size_t o;
+
+    for (size_t i = 0; i < se || i < sr; i++) {
+        o = i * COLL_SEGMENT;
+        if (i < se)
+            deposer(c, boite(c, c->rang, dst), env + o,
+                    MIN(COLL_SEGMENT, tenv - o));
+        if (i < sr)
+            retirer(c, boite(c, src, c->rang), rec + o,
+                    MIN(COLL_SEGMENT, trec - o), op);
+    }
+}
+
+static char *tampon(struct coll *c, size_t taille) {
+    if (taille > c->taille_tmp) {
+        free(c->tmp);
+        if ((c->tmp = malloc(taille)) == NULL)
+            raler(1, "malloc %zu", taille);
+        c->taille_tmp = taille;
+    }
+    return c->tmp;
+}
+
+static int log2_sup(int n) {
+    int l = 0;
+    while ((1 << l) < n)
+        l++;
+    return l;
+}
+
+/*
+ * Choix de l'algorithme : 1 pour la variante logarithmique (arbre ou
+ * doublement), 0 pour l'anneau.
+ * - diffusion, réduction : sur S segments, la chaîne pipelinée coûte
+ *   environ n-1+S étapes et l'arbre S*log2(n) ;
+ * - collecte, échange total : le doublement gagne tant que la latence
+ *   domine, c'est-à-dire pour de petits blocs.
+ */
+static int arbre(struct coll *c, size_t taille) {
+    size_t s = nb_segments(taille);
+
+    if (c->algo != COLL_AUTO)
+        return c->algo != COLL_ANNEAU;
+    return s * log2_sup(c->n) <= c->n - 1 + s;
+}
+
+static int doublement(struct coll *c, size_t taille, size_t seuil) {
+    if (c->algo != COLL_AUTO)
+        return c->algo != COLL_ANNEAU;
+    return taille <= seuil;
+}
+
+int coll_init(struct coll *c, int n) {
+    c->n = n;
+    c->rang = 0;
+    c->algo = COLL_AUTO;
+    c->attente = 0;
+    c->tmp = NULL;
+    c->taille_tmp = 0;
+    c->taille = (size_t)n * n * sizeof(struct coll_boite);
+    // seules les boîtes réellement utilisées occupent de la mémoire
+    c->b = mmap(NULL, c->taille, PROT_READ | PROT_WRITE,
+                MAP_SHARED | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (c->b == MAP_FAILED)
+        return -1;
+    return 0;
+}
+
+void coll_rejoindre(struct coll *c, int rang) { c->rang = rang; }
+
+void coll_detruire(struct coll *c) {
+    free(c->tmp);
+    c->tmp = NULL;
+    c->taille_tmp = 0;
+    if (munmap(c->b, c->taille) == -1)
+        raler(1, "munmap");
+}
+
+const char *coll_nom_algo(enum coll_algo algo) {
+    switch (algo) {
+    case COLL_AUTO:
+        return "auto";
+    case COLL_ANNEAU:
+        return "anneau";
+    case COLL_ARBRE:
+        return "arbre";
+    case COLL_DOUBLEMENT:
+        return "doublement";
+    }
+    return "?";
+}
+
+void coll_echanger(struct coll *c, int dst, const void *env, size_t tenv,
+                   int src, void *rec, size_t trec) {
+    echanger(c, dst, env, tenv, src, rec, trec, PAS_DE_COMBINAISON);
+}
+
+// barrière par dissémination : log2(n) échanges de jetons
+void coll_barriere(struct coll *c) {
+    int n = c->n, r = c->rang;
+
+    for (int k = 1; k < n; k <<= 1)
+        echanger(c, (r + k) % n, NULL, 0, (r - k + n) % n, NULL, 0,
+                 PAS_DE_COMBINAISON);
+}
+
+void coll_decaler(struct coll *c, const void *env, void *rec, size_t taille) {
+    int n = c->n, r = c->rang;
+
+    if (n == 1)
+        memcpy(rec, env, taille);
+    else
+        echanger(c, (r + 1) % n, env, taille, (r - 1 + n) % n, rec, taille,
+                 PAS_DE_COMBINAISON);
+}
+
+void coll_diffuser(struct coll *c, void *buf, size_t taille, int racine) {
+    int n = c->n;
+    int v = (c->rang - racine + n) % n; // rang relatif à la racine
+    int masque;
+    char *p = buf;
+
+    if (arbre(c, taille)) {
+        // arbre binomial : recevoir du père, puis servir les fils
+        for (masque = 1; masque < n; masque <<= 1) {
+            if (v & masque) {
+                echanger(c, -1, NULL, 0, (v - masque + racine) % n, p,
+                         taille, PAS_DE_COMBINAISON);
+                break;
+            }
+        }
+        for (masque >>= 1; masque > 0; masque >>= 1)
+            if (v + masque < n)
+                echanger(c, (v + masque + racine) % n, p, taille, -1, NULL,
+                         0, PAS_DE_COMBINAISON);
+    } else {
+        // chaîne pipelinée : chaque segment est relayé dès sa réception
+        size_t s = nb_segments(taille);
+        for (size_t i = 0; i < s; i++) {
+            size_t o = i * COLL_SEGMENT, t = MIN(COLL_SEGMENT, taille - o);
+            if (v > 0)
+                retirer(c, boite(c, (v - 1 + racine) % n, c->rang), p + o, t,
+                        PAS_DE_COMBINAISON);
+            if (v < n - 1)
+                deposer(c, boite(c, c->rang, (v + 1 + racine) % n), p + o, t);
+        }
+    }
+}
+
+void coll_reduire(struct coll *c, const int64_t *env, int64_t *rec, size_t nb,
+                  enum coll_op op, int racine) {
+    int n = c->n;
+    int v = (c->rang - racine + n) % n;
+    size_t taille = nb * sizeof(int64_t);
+    char *acc = v == 0 ? (char *)rec : tampon(c, taille);
+
+    memcpy(acc, env, taille);
+
+    if (arbre(c, taille)) {
+        // arbre binomial : combiner les sous-arbres puis remonter
+        for (int masque = 1; masque < n; masque <<= 1) {
+            if (v & masque) {
+                echanger(c, (v - masque + racine) % n, acc, taille, -1, NULL,
+                         0, PAS_DE_COMBINAISON);
+                break;
+            }
+            if (v + masque < n)
+                echanger(c, -1, NULL, 0, (v + masque + racine) % n, acc,
+                         taille, op);
+        }
+    } else {
+        // chaîne pipelinée de n-1 vers la racine
+        size_t s = nb_segments(taille);
+        for (size_t i = 0; i < s; i++) {
+            size_t o = i * COLL_SEGMENT, t = MIN(COLL_SEGMENT, taille - o);
+            if (v < n - 1)
+                retirer(c, boite(c, (v + 1 + racine) % n, c->rang), acc + o, t,
+                        op);
+            if (v > 0)
+                deposer(c, boite(c, c->rang, (v - 1 + racine) % n), acc + o,
+                        t);
+        }
+    }
+}
+
+void coll_collecter(struct coll *c, const void *env, void *rec,
+                    size_t taille) {
+    int n = c->n, r = c->rang;
+    char *res = rec;
+
+    if (doublement(c, taille, COLL_SEUIL)) {
+        // Bruck : tmp[i] contient le bloc du rang r+i
+        char *tmp = tampon(c, n * taille);
+        memcpy(tmp, env, taille);
+        for (int k = 1; k < n; k <<= 1) {
+            int nb = MIN(k, n - k);
+            echanger(c, (r - k + n) % n, tmp, nb * taille, (r + k) % n,
+                     tmp + k * taille, nb * taille, PAS_DE_COMBINAISON);
+        }
+        for (int i = 0; i < n; i++)
+            memcpy(res + (r + i) % n * taille, tmp + i * taille, taille);
+    } else {
+        // anneau : à l'étape s, transmettre le bloc reçu à l'étape s-1
+        memcpy(res + r * taille, env, taille);
+        for (int s = 0; s < n - 1; s++) {
+            int be = (r - s + n) % n, br = (r - s - 1 + n) % n;
+            echanger(c, (r + 1) % n, res + be * taille, taille,
+                     (r - 1 + n) % n, res + br * taille, taille,
+                     PAS_DE_COMBINAISON);
+        }
+    }
+}
+
+void coll_echange_total(struct coll *c, const void *env, void *rec,
+                        size_t taille) {
+    int n = c->n, r = c->rang;
+    const char *e = env;
+    char *res = rec;
+
+    if (doublement(c, taille, COLL_SEUIL_ECH)) {
+        /*
+         * Bruck : après rotation, tmp[i] est destiné au rang r+i. À
+         * l'étape k, les blocs dont l'indice a le bit k avancent de k
+         * rangs ; au bout de log2(n) étapes chacun a avancé de i.
+         */
+        char *tmp = tampon(c, 3 * n * taille);
+        char *env_k = tmp + n * taille, *rec_k = tmp + 2 * n * taille;
+        size_t nb;
+
+        for (int i = 0; i < n; i++)
+            memcpy(tmp + i * taille, e + (r + i) % n * taille, taille);
+        for (int k = 1; k < n; k <<= 1) {
+            nb = 0;
+            for (int i = k; i < n; i++)
+                if (i & k)
+                    memcpy(env_k + nb++ * taille, tmp + i * taille, taille);
+            echanger(c, (r + k) % n, env_k, nb * taille, (r - k + n) % n,
+                     rec_k, nb * taille, PAS_DE_COMBINAISON);
+            nb = 0;
+            for (int i = k; i < n; i++)
+                if (i & k)
+                    memcpy(tmp + i * taille, rec_k + nb++ * taille, taille);
+        }
+        for (int i = 0; i < n; i++)
+            memcpy(res + (r - i + n) % n * taille, tmp + i * taille, taille);
+    } else {
+        // échange par paires : à l'étape s, envoyer à r+s, recevoir de r-s
+        memcpy(res + r * taille, e + r * taille, taille);
+        for (int s = 1; s < n; s++) {
+            int dst = (r + s) % n, src = (r - s + n) % n;
+            echanger(c, dst, e + dst * taille, taille, src,
+                     res + src * taille, taille, PAS_DE_COMBINAISON);
+        }
+    }
+}
@@ -0,0 +1,75 @@
+#ifndef COLLECTIF_H
+#define COLLECTIF_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdnoreturn.h>
+
+/*
+ * Communications collectives entre n processus issus d'un même père,
+ * généralisant l'échange de la ronde (chacun publie une valeur et lit
+ * celle de son voisin).
+ *
+ * Le père appelle coll_init() avant les fork, puis chaque processus
+ * appelle coll_rejoindre() avec son rang (0 à n-1). Toutes les fonctions
+ * collectives doivent être appelées par les n processus, dans le même
+ * ordre et avec les mêmes tailles.
+ *
+ * Les messages transitent par des boîtes aux lettres point à point dans
+ * une projection partagée, découpés en segments de COLL_SEGMENT octets.
+ * Chaque collective existe en plusieurs algorithmes :
+ * - anneau : n-1 étapes, mais chaque lien ne transporte que sa part et
+ *   les segments sont pipelinés, adapté aux gros messages ;
+ * - arbre binomial (diffusion, réduction) : log2(n) étapes ;
+ * - doublement récursif, variante de Bruck valable pour tout n (collecte,
+ *   échange total) : log2(n) étapes mais davantage d'octets recopiés.
+ * COLL_AUTO choisit selon la taille des blocs et le nombre de processus.
+ */
+
+#define COLL_SEGMENT 4096 // taille d'un segment (multiple de 8)
+#define COLL_PROF 2       // nb de segments en attente par boîte
+#define COLL_SEUIL 8192   // bloc au-delà duquel l'anneau gagne (collecte)
+#define COLL_SEUIL_ECH 512 // idem pour l'échange total
+
+enum coll_algo { COLL_AUTO, COLL_ANNEAU, COLL_ARBRE, COLL_DOUBLEMENT };
+
+enum coll_op { COLL_SOMME, COLL_MIN, COLL_MAX };
+
+struct coll {
+    int n;                // nb de processus
+    int rang;             // rang du processus appelant
+    enum coll_algo algo;  // algorithme imposé (COLL_AUTO par défaut)
+    int attente;          // nb d'itérations d'attente active avant futex
+    struct coll_boite *b; // n*n boîtes, [src * n + dst]
+    size_t taille;        // taille de la projection
+    char *tmp;            // tampon de travail local
+    size_t taille_tmp;
+};
+
+int coll_init(struct coll *c, int n);
+void coll_rejoindre(struct coll *c, int rang);
+void coll_detruire(struct coll *c);
+
+const char *coll_nom_algo(enum coll_algo algo);
+
+// point à point : envoi vers dst et réception depuis src simultanés
+void coll_echanger(struct coll *c, int dst, const void *env, size_t tenv,
+                   int src, void *rec, size_t trec);
+
+void coll_barriere(struct coll *c);
+// la ronde : chacun envoie à rang+1 et reçoit de rang-1
+void coll_decaler(struct coll *c, const void *env, void *rec, size_t taille);
+void coll_diffuser(struct coll *c, void *buf, size_t taille, int racine);
+void coll_reduire(struct coll *c, const int64_t *env, int64_t *rec, size_t nb,
+                  enum coll_op op, int racine);
+// rec reçoit n blocs de taille octets, dans l'ordre des rangs
+void coll_collecter(struct coll *c, const void *env, void *rec,
+                    size_t taille);
+// env et rec contiennent n blocs de taille octets (bloc i : pour/de i)
+void coll_echange_total(struct coll *c, const void *env, void *rec,
+                        size_t taille);
+
+// fournie par le programme : affiche le message et termine le processus
+noreturn void raler(int syserr, const char *fmt, ...);
+
+#endif
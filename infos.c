@@ -1,7 +1,9 @@
 #include <ctype.h>
-#include <dirent.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <getopt.h>
+#include <inttypes.h>
+#include <pthread.h>
 #include <stdarg.h>
 #include <stdint.h>
 #include <stdio.h>
@@ -12,6 +14,13 @@
 #include <sys/types.h>
 #include <unistd.h>
 
+#include "lettres_unicode.h"
+#include "parcours.h"
+
+#define USAGE                                                                  \
+    "usage: infos [-j nthreads] [-l] [-c|-d] [-u|--unique-inodes]\n"         \
+    "             [-U|--utf8] repertoire"
+
 #define CHK(op)                                                                \
     do {                                                                       \
         if ((op) == -1)                                                        \
@@ -22,6 +31,12 @@
         if ((op) == NULL)                                                      \
             raler(1, #op);                                                     \
     } while (0)
+// les fonctions pthread_* renvoient le code d'erreur au lieu de -1
+#define CHKT(op)                                                               \
+    do {                                                                       \
+        if ((errno = (op)) != 0)                                               \
+            raler(1, #op);                                                     \
+    } while (0)
 
 #define CHEMIN_MAX 128
 #define MAXBUF 4096
@@ -38,12 +53,211 @@ noreturn void raler(int syserr, const char *fmt, ...) {
     exit(1);
 }
 
+/*
+ * Empreinte CRC32C (polynôme de Castagnoli), calculée sur le tampon
+ * déjà lu pour les comptages : instruction crc32 de SSE4.2 si le
+ * processeur la fournit (8 octets par instruction), table sinon.
+ */
+enum { SANS_EMPREINTE, EMPREINTE, DOUBLONS } empreinte = SANS_EMPREINTE;
+
+uint32_t crc_table[256];
+
+uint32_t crc_logiciel(uint32_t crc, const char *buf, size_t n) {
+    for (size_t i = 0; i < n; i++)
+        crc = crc_table[(crc ^ (unsigned char)buf[i]) & 0xff] ^ (crc >> 8);
+    return crc;
+}
+
+#if defined(__x86_64__)
+__attribute__((target("sse4.2"))) uint32_t
+crc_materiel(uint32_t crc, const char *buf, size_t n) {
+    uint64_t c = crc, v;
+    size_t i = 0;
+
+    for (; i + sizeof v <= n; i += sizeof v) {
+        memcpy(&v, buf + i, sizeof v);
+        c = __builtin_ia32_crc32di(c, v);
+    }
+    for (; i < n; i++)
+        c = __builtin_ia32_crc32qi((uint32_t)c, buf[i]);
+    return (uint32_t)c;
+}
+#endif
+
+uint32_t (*crc32c)(uint32_t crc, const char *buf, size_t n) = crc_logiciel;
+
+void crc_init(void) {
+#if defined(__x86_64__)
+    if (__builtin_cpu_supports("sse4.2")) {
+        crc32c = crc_materiel;
+        return;
+    }
+#endif
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t c = i;
+        for (int k = 0; k < 8; k++)
+            c = c & 1 ? (c >> 1) ^ 0x82f63b78 : c >> 1;
+        crc_table[i] = c;
+    }
+}
+
+/*
+ * Mode UTF-8 (-U) : les lettres sont les points de code de catégorie
+ * Unicode L*, et les séquences invalides (octet inattendu, forme trop
+ * longue, surrogate, au-delà de U+10FFFF) sont comptées. Les blocs de
+ * 16 octets purement ASCII sont classés d'un coup par les extensions
+ * vectorielles de gcc (SSE2 sur x86-64) ; le reste est décodé point
+ * par point, la catégorie étant cherchée par dichotomie dans
+ * lettres_unicode.h.
+ */
+int utf8 = 0;
+
+typedef unsigned char octets16 __attribute__((vector_size(16)));
+
+struct compteurs {
+    off_t lignes, lettres, invalides;
+};
+
+int lettre_unicode(uint32_t c) {
+    static const size_t n = sizeof lettres_unicode / sizeof lettres_unicode[0];
+    size_t bas = 0, haut = n;
+
+    while (bas < haut) {
+        size_t m = (bas + haut) / 2;
+        if (c < lettres_unicode[m][0])
+            haut = m;
+        else if (c > lettres_unicode[m][1])
+            bas = m + 1;
+        else
+            return 1;
+    }
+    return 0;
+}
+
+// ajoute les compteurs vectoriels (au plus 255 par case) à k
+void vider(struct compteurs *k, octets16 *lettres, octets16 *lignes) {
+    for (int j = 0; j < 16; j++) {
+        k->lettres += (*lettres)[j];
+        k->lignes += (*lignes)[j];
+    }
+    *lettres = *lignes = (octets16){0};
+}
+
+/*
+ * Décode une séquence à partir de b[0] (n octets disponibles, n > 0).
+ * Renvoie sa longueur, *c valant le point de code ou -1 si elle est
+ * invalide (sa partie valide est alors consommée) ; renvoie 0 si la
+ * séquence est tronquée par la fin du tampon.
+ */
+size_t decoder(const unsigned char *b, size_t n, int32_t *c) {
+    unsigned char min = 0x80, max = 0xbf;
+    size_t lg;
+    int32_t v;
+
+    if (b[0] >= 0xc2 && b[0] <= 0xdf)
+        lg = 2, v = b[0] & 0x1f;
+    else if (b[0] >= 0xe0 && b[0] <= 0xef) {
+        lg = 3, v = b[0] & 0x0f;
+        if (b[0] == 0xe0)
+            min = 0xa0; // forme trop longue
+        else if (b[0] == 0xed)
+            max = 0x9f; // surrogates
+    } else if (b[0] >= 0xf0 && b[0] <= 0xf4) {
+        lg = 4, v = b[0] & 0x07;
+        if (b[0] == 0xf0)
+            min = 0x90;
+        else if (b[0] == 0xf4)
+            max = 0x8f; // au-delà de U+10FFFF
+    } else {
+        *c = -1;
+        return 1;
+    }
+
+    for (size_t i = 1; i < lg; i++) {
+        if (i >= n)
+            return 0;
+        if (b[i] < min || b[i] > max) {
+            *c = -1;
+            return i;
+        }
+        min = 0x80, max = 0xbf;
+        v = (v << 6) | (b[i] & 0x3f);
+    }
+    *c = v;
+    return lg;
+}
+
+/*
+ * Compte les n octets de b. Renvoie le nombre d'octets traités : une
+ * séquence tronquée en fin de tampon est laissée pour la lecture
+ * suivante, sauf en fin de fichier où elle est invalide.
+ */
+size_t compter_utf8(struct compteurs *k, const unsigned char *b, size_t n,
+                    int fin) {
+    octets16 v, lettres = {0}, lignes = {0};
+    uint64_t w[2];
+    size_t i = 0, lg, bloc;
+    int tours = 0;
+    int32_t c;
+
+    while (i < n) {
+        if (i + 16 <= n) {
+            memcpy(&v, b + i, sizeof v);
+            memcpy(w, &v, sizeof w);
+            if (((w[0] | w[1]) & 0x8080808080808080u) == 0) {
+                // chemin rapide : 16 octets ASCII
+                lettres -= (octets16)(((v | 0x20) - 'a') < 26);
+                lignes -= (octets16)(v == '\n');
+                i += 16;
+                if (++tours == 255) {
+                    vider(k, &lettres, &lignes);
+                    tours = 0;
+                }
+                continue;
+            }
+        }
+
+        // chemin lent jusqu'à la fin du bloc de 16 octets
+        bloc = i + 16;
+        while (i < n && i < bloc) {
+            if (b[i] < 0x80) {
+                if ((unsigned char)((b[i] | 0x20) - 'a') < 26)
+                    k->lettres++;
+                else if (b[i] == '\n')
+                    k->lignes++;
+                i++;
+                continue;
+            }
+            if ((lg = decoder(b + i, n - i, &c)) == 0) {
+                if (!fin) {
+                    vider(k, &lettres, &lignes);
+                    return i;
+                }
+                k->invalides++;
+                i = n;
+                break;
+            }
+            if (c < 0)
+                k->invalides++;
+            else if (lettre_unicode(c))
+                k->lettres++;
+            i += lg;
+        }
+    }
+    vider(k, &lettres, &lignes);
+    return n;
+}
+
 struct infos {
     char chemin[CHEMIN_MAX + 1];
+    dev_t dev;
     ino_t inode;
+    nlink_t nliens;
     off_t taille;
     off_t nblignes;
     off_t nblettres;
+    off_t invalides; // séquences UTF-8 invalides (mode -U)
+    uint32_t crc;
 };
 
 #define TABDYN_INCREMENT 50 // on alloue ce nb d'entrées à chaque fois
@@ -51,58 +265,282 @@ struct tabdyn {
     int dim;           // dimension du tableau (taille allocation)
     int nbent;         // nombre d'entrées actuellement utilisées
     struct infos *tab; // le tableau lui-même
+    pthread_mutex_t m; // parcours avec plusieurs threads
 };
 
 void tab_init(struct tabdyn *t) {
     t->dim = t->nbent = 0;
     t->tab = NULL;
+    CHKT(pthread_mutex_init(&t->m, NULL));
 }
 
 void tab_add(struct tabdyn *t, struct infos *i) {
+    CHKT(pthread_mutex_lock(&t->m));
     if (t->nbent >= t->dim) {
         t->dim += TABDYN_INCREMENT;
         CHKN(t->tab = realloc(t->tab, t->dim * sizeof(struct infos)));
     }
     // on sait qu'on a suffisamment de place pour ajouter une entrée
     t->tab[t->nbent++] = *i;
+    CHKT(pthread_mutex_unlock(&t->m));
 }
 
 int compare(const void *v1, const void *v2) {
     const struct infos *i1 = v1;
     const struct infos *i2 = v2;
 
-    return (i1->inode < i2->inode) ? -1 : ((i1->inode > i2->inode) ? 1 : 0);
+    if (i1->inode != i2->inode)
+        return i1->inode < i2->inode ? -1 : 1;
+    return (i1->dev < i2->dev) ? -1 : ((i1->dev > i2->dev) ? 1 : 0);
 }
 
 void tab_sort(struct tabdyn *t) {
     qsort(t->tab, t->nbent, sizeof(struct infos), compare);
 }
 
+// colonnes communes : taille, lignes, lettres [invalides] [empreinte] chemin
+void print_comptages(const struct infos *p) {
+    printf("%jd %jd %jd ", (intmax_t)p->taille, (intmax_t)p->nblignes,
+           (intmax_t)p->nblettres);
+    if (utf8)
+        printf("%jd ", (intmax_t)p->invalides);
+    if (empreinte != SANS_EMPREINTE)
+        printf("%08" PRIx32 " ", p->crc);
+    printf("%s\n", p->chemin);
+}
+
 void tab_print(struct tabdyn *t) {
+    for (int i = 0; i < t->nbent; i++) {
+        printf("%ju ", (uintmax_t)t->tab[i].inode);
+        print_comptages(&t->tab[i]);
+    }
+}
+
+// une ligne par inode (trié) avec son nombre de liens, premier chemin
+void tab_print_inodes(struct tabdyn *t) {
     for (int i = 0; i < t->nbent; i++) {
         struct infos *p = &t->tab[i];
-        printf("%ju %jd %jd %jd %s\n", (uintmax_t)p->inode, (intmax_t)p->taille,
-               (intmax_t)p->nblignes, (intmax_t)p->nblettres, p->chemin);
+        if (i > 0 && p->inode == p[-1].inode && p->dev == p[-1].dev)
+            continue;
+        printf("%ju %ju ", (uintmax_t)p->inode, (uintmax_t)p->nliens);
+        print_comptages(p);
     }
 }
 
+// tri par empreinte puis taille : les doublons possibles sont voisins
+int compare_empreinte(const void *v1, const void *v2) {
+    const struct infos *i1 = v1;
+    const struct infos *i2 = v2;
+
+    if (i1->crc != i2->crc)
+        return i1->crc < i2->crc ? -1 : 1;
+    if (i1->taille != i2->taille)
+        return i1->taille < i2->taille ? -1 : 1;
+    return strcmp(i1->chemin, i2->chemin);
+}
+
+// une empreinte de 32 bits peut se tromper : comparer les contenus
+int identiques(const char *chemin1, const char *chemin2) {
+    char buf1[MAXBUF], buf2[MAXBUF];
+    ssize_t n1, n2;
+    int fd1, fd2, r = 1;
+
+    CHK(fd1 = open(chemin1, O_RDONLY));
+    CHK(fd2 = open(chemin2, O_RDONLY));
+    do {
+        CHK(n1 = read(fd1, buf1, sizeof buf1));
+        CHK(n2 = read(fd2, buf2, sizeof buf2));
+        if (n1 != n2 || memcmp(buf1, buf2, n1) != 0)
+            r = 0;
+    } while (r && n1 > 0);
+    CHK(close(fd1));
+    CHK(close(fd2));
+    return r;
+}
+
+/*
+ * Affiche chaque ensemble de fichiers identiques (au moins deux),
+ * séparés par une ligne vide : "empreinte taille chemin".
+ */
+void tab_doublons(struct tabdyn *t) {
+    char *vu;
+    int debut, fin, premier = 1;
+
+    qsort(t->tab, t->nbent, sizeof(struct infos), compare_empreinte);
+    CHKN(vu = calloc(t->nbent + 1, 1)); // déjà dans un ensemble
+    for (debut = 0; debut < t->nbent; debut = fin) {
+        // même empreinte et même taille : candidats
+        fin = debut + 1;
+        while (fin < t->nbent && t->tab[fin].crc == t->tab[debut].crc &&
+               t->tab[fin].taille == t->tab[debut].taille)
+            fin++;
+        for (int i = debut; i < fin; i++) {
+            int n = 0;
+            if (vu[i])
+                continue;
+            for (int j = i + 1; j < fin; j++) {
+                if (vu[j] || !identiques(t->tab[i].chemin, t->tab[j].chemin))
+                    continue;
+                if (n++ == 0) {
+                    if (!premier)
+                        printf("\n");
+                    premier = 0;
+                    printf("%08" PRIx32 " %jd %s\n", t->tab[i].crc,
+                           (intmax_t)t->tab[i].taille, t->tab[i].chemin);
+                }
+                vu[j] = 1;
+                printf("%08" PRIx32 " %jd %s\n", t->tab[j].crc,
+                       (intmax_t)t->tab[j].taille, t->tab[j].chemin);
+            }
+        }
+    }
+    free(vu);
+}
+
 void tab_destroy(struct tabdyn *t) {
     if (t->dim > 0)
         free(t->tab);
-    tab_init(t);
+    t->dim = t->nbent = 0;
+    t->tab = NULL;
+    CHKT(pthread_mutex_destroy(&t->m));
+}
+
+/*
+ * Inodes à plusieurs liens déjà rencontrés, indexés par (dev, ino) :
+ * un fichier à n liens n'est lu qu'une fois, les autres chemins
+ * recopient ses comptages. Table à chaînage, protégée par VERROUS
+ * verrous (un par tranche d'alvéoles) pour le parcours multi-thread.
+ * Un thread qui trouve l'inode en cours de lecture attend sa fin.
+ */
+#define ALVEOLES 65536
+#define VERROUS 64
+
+struct noeud {
+    struct noeud *suiv;
+    dev_t dev;
+    ino_t inode;
+    int pret;          // comptages disponibles
+    struct infos i;
+};
+
+struct {
+    struct noeud **alv;
+    pthread_mutex_t m[VERROUS];
+    pthread_cond_t c[VERROUS];
+} inodes;
+
+void inodes_init(void) {
+    CHKN(inodes.alv = calloc(ALVEOLES, sizeof *inodes.alv));
+    for (int i = 0; i < VERROUS; i++) {
+        CHKT(pthread_mutex_init(&inodes.m[i], NULL));
+        CHKT(pthread_cond_init(&inodes.c[i], NULL));
+    }
+}
+
+void inodes_detruire(void) {
+    struct noeud *n, *suiv;
+
+    for (int a = 0; a < ALVEOLES; a++) {
+        for (n = inodes.alv[a]; n != NULL; n = suiv) {
+            suiv = n->suiv;
+            free(n);
+        }
+    }
+    free(inodes.alv);
+    for (int i = 0; i < VERROUS; i++) {
+        CHKT(pthread_mutex_destroy(&inodes.m[i]));
+        CHKT(pthread_cond_destroy(&inodes.c[i]));
+    }
+}
+
+unsigned alveole(dev_t dev, ino_t inode) {
+    uint64_t h = ((uint64_t)dev * 0x9e3779b97f4a7c15u) ^ (uint64_t)inode;
+
+    h *= 0xff51afd7ed558ccdu;
+    return (unsigned)(h >> 48) & (ALVEOLES - 1);
 }
 
-void chercher_infos(const char *chemin, struct stat *stbuf, struct infos *i) {
+/*
+ * Renvoie NULL si les comptages de l'inode ont été recopiés dans i ;
+ * sinon l'inode est réservé et l'appelant doit le lire puis appeler
+ * inode_publier avec le noeud renvoyé.
+ */
+struct noeud *inode_consulter(struct infos *i) {
+    unsigned a = alveole(i->dev, i->inode);
+    pthread_mutex_t *m = &inodes.m[a % VERROUS];
+    pthread_cond_t *c = &inodes.c[a % VERROUS];
+    struct noeud *n;
+
+    CHKT(pthread_mutex_lock(m));
+    for (n = inodes.alv[a]; n != NULL; n = n->suiv)
+        if (n->inode == i->inode && n->dev == i->dev)
+            break;
+    if (n != NULL) {
+        while (!n->pret)
+            CHKT(pthread_cond_wait(c, m));
+        i->taille = n->i.taille;
+        i->nblignes = n->i.nblignes;
+        i->nblettres = n->i.nblettres;
+        i->invalides = n->i.invalides;
+        i->crc = n->i.crc;
+        n = NULL;
+    } else {
+        CHKN(n = malloc(sizeof *n));
+        n->dev = i->dev;
+        n->inode = i->inode;
+        n->pret = 0;
+        n->suiv = inodes.alv[a];
+        inodes.alv[a] = n;
+    }
+    CHKT(pthread_mutex_unlock(m));
+    return n;
+}
+
+void inode_publier(struct noeud *n, const struct infos *i) {
+    unsigned a = alveole(n->dev, n->inode);
+
+    CHKT(pthread_mutex_lock(&inodes.m[a % VERROUS]));
+    n->i = *i;
+    n->pret = 1;
+    CHKT(pthread_cond_broadcast(&inodes.c[a % VERROUS]));
+    CHKT(pthread_mutex_unlock(&inodes.m[a % VERROUS]));
+}
+
+// fichier ouvert relativement à son répertoire : un seul fstat
+void chercher_infos(const struct parc_entree *e, struct infos *i) {
     int fd;
-    char buf[MAXBUF];
+    char buf[MAXBUF + 3]; // + séquence UTF-8 tronquée
     ssize_t nlus;
+    size_t reste = 0, n, fait;
+    struct compteurs k = {0, 0, 0};
+    struct stat stbuf;
+    struct noeud *noeud = NULL;
 
-    strcpy(i->chemin, chemin);
-    i->inode = stbuf->st_ino;
-    i->taille = stbuf->st_size;
-    i->nblignes = i->nblettres = 0;
-    CHK(fd = open(chemin, O_RDONLY));
-    while ((nlus = read(fd, buf, sizeof buf)) > 0) {
+    strcpy(i->chemin, e->chemin);
+    CHK(fd = openat(e->dirfd, e->nom, O_RDONLY | O_NOFOLLOW));
+    CHK(fstat(fd, &stbuf));
+    i->dev = stbuf.st_dev;
+    i->inode = stbuf.st_ino;
+    i->nliens = stbuf.st_nlink;
+    // un seul lien : personne d'autre ne lira ce fichier
+    if (stbuf.st_nlink > 1 && (noeud = inode_consulter(i)) == NULL) {
+        CHK(close(fd));
+        return;
+    }
+    i->taille = stbuf.st_size;
+    i->nblignes = i->nblettres = i->invalides = 0;
+    i->crc = ~(uint32_t)0;
+    while ((nlus = read(fd, buf + reste, MAXBUF)) > 0) {
+        if (empreinte != SANS_EMPREINTE)
+            i->crc = crc32c(i->crc, buf + reste, nlus);
+        if (utf8) {
+            // garder la séquence tronquée pour la lecture suivante
+            n = reste + nlus;
+            fait = compter_utf8(&k, (unsigned char *)buf, n, 0);
+            reste = n - fait;
+            memmove(buf, buf + fait, reste);
+            continue;
+        }
         for (int j = 0; j < nlus; j++) {
             if (isalpha(buf[j]))
                 i->nblettres++;
@@ -112,64 +550,82 @@ void chercher_infos(const char *chemin, struct stat *stbuf, struct infos *i) {
     }
     CHK(nlus);
     CHK(close(fd));
+    i->crc = ~i->crc;
+    if (utf8) {
+        compter_utf8(&k, (unsigned char *)buf, reste, 1);
+        i->nblignes = k.lignes;
+        i->nblettres = k.lettres;
+        i->invalides = k.invalides;
+    }
+    if (noeud != NULL)
+        inode_publier(noeud, i);
 }
 
-void parcourir(struct tabdyn *t, const char *chemin) {
-    DIR *dp;
-    struct dirent *d;
-    struct stat stbuf;
-    char nch[CHEMIN_MAX + 1];
-    int l;
+void entree(const struct parc_entree *e, void *arg) {
     struct infos i;
 
-    CHKN(dp = opendir(chemin));
-
-    errno = 0;
-    while ((d = readdir(dp)) != NULL) {
-        if (strcmp(d->d_name, ".") != 0 && strcmp(d->d_name, "..") != 0) {
-            CHK(l = snprintf(nch, sizeof nch, "%s/%s", chemin, d->d_name));
-            if (l >= (int)sizeof nch)
-                raler(0, "chemin %s/%s trop long", chemin, d->d_name);
-            CHK(lstat(nch, &stbuf));
-
-            switch (stbuf.st_mode & S_IFMT) {
-            case S_IFDIR:
-                parcourir(t, nch);
-                break;
-
-            case S_IFREG:
-                chercher_infos(nch, &stbuf, &i);
-                tab_add(t, &i);
-                break;
-
-            case S_IFLNK:
-                // ignorer ce cas
-                break;
-
-            default:
-                // dans tous les autres cas (non connus), on ignore
-                break;
-            }
-        }
-
-        errno = 0;
+    // liens symboliques et autres cas (non connus) ignorés
+    if (e->type == PARC_FICHIER) {
+        chercher_infos(e, &i);
+        tab_add(arg, &i);
     }
-    if (errno != 0)
-        raler(1, "readdir");
-
-    CHK(closedir(dp));
 }
 
-int main(int argc, const char *argv[]) {
+int main(int argc, char *argv[]) {
     struct tabdyn t;
+    struct parcours p;
+    int opt, uniques = 0;
+    const struct option longues[] = {
+        {"unique-inodes", no_argument, NULL, 'u'},
+        {"utf8", no_argument, NULL, 'U'},
+        {NULL, 0, NULL, 0},
+    };
 
-    if (argc != 2)
-        raler(0, "usage: infos repertoire");
+    parc_init(&p, CHEMIN_MAX);
+    while ((opt = getopt_long(argc, argv, "j:lcduU", longues, NULL)) != -1) {
+        switch (opt) {
+        case 'j':
+            if ((p.nthreads = atoi(optarg)) <= 0)
+                raler(0, USAGE);
+            break;
+        case 'l':
+            p.ordre = PARC_LARGEUR;
+            break;
+        case 'c':
+            empreinte = EMPREINTE;
+            break;
+        case 'd':
+            empreinte = DOUBLONS;
+            break;
+        case 'u':
+            uniques = 1;
+            break;
+        case 'U':
+            utf8 = 1;
+            break;
+        default:
+            raler(0, USAGE);
+        }
+    }
+    if (argc - optind != 1)
+        raler(0, USAGE);
 
+    crc_init();
+    inodes_init();
     tab_init(&t);
-    parcourir(&t, argv[1]);
-    tab_sort(&t);
-    tab_print(&t);
+    p.entree = entree;
+    p.arg = &t;
+    parc_lancer(&p, argv[optind]);
+    if (empreinte == DOUBLONS)
+        tab_doublons(&t);
+    else {
+        tab_sort(&t);
+        if (uniques)
+            tab_print_inodes(&t);
+        else
+            tab_print(&t);
+    }
     tab_destroy(&t);
+    inodes_detruire();
     exit(0);
 }
@@ -0,0 +1,524 @@
+#define _GNU_SOURCE // clone, close_range
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sched.h>
+#include <signal.h>
+#include <spawn.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/prctl.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "lancement.h"
+
+#define PILE_CLONE (64 * 1024) // pile du fils clone, jusqu'à son exec
+#define REQ_MAX 65536          // taille maximale d'une commande (pool)
+#define POOL_DEFAUT 2
+#define SONDE_MS 10 // fils directs et serveurs à la fois : scrutation
+
+extern char **environ;
+
+enum mode { L_FORK, L_VFORK, L_SPAWN, L_CLONE, L_POOL };
+
+static const char *noms[] = {"fork", "vfork", "spawn", "clone", "pool"};
+
+static int mode = -1; // -1 : LANCEMENT pas encore lu
+static int directs;   // fils directs pas encore attendus
+
+/*
+ * vfork et clone : le fils partage la mémoire du père, suspendu jusqu'à
+ * l'exec. En cas d'échec, le fils dépose errno ici avant _exit, comme le
+ * fait posix_spawn.
+ */
+static volatile int erreur_fils;
+static _Alignas(16) char pile[PILE_CLONE];
+
+struct tache {
+    char *const *argv;
+    int entree, sortie;
+};
+
+/*
+ * Serveurs de lancement (pool). Protocole sur une socket SOCK_SEQPACKET :
+ * l'appelant envoie une requête (arguments, et 0 à 2 descripteurs en
+ * SCM_RIGHTS), le serveur répond DEMARRE avec le pid ou l'erreur de
+ * posix_spawnp, puis plus tard TERMINE avec le code de retour.
+ */
+struct requete {
+    int entree, sortie; // 1 si le descripteur accompagne la requête
+    int argc;
+};
+
+enum { DEMARRE, TERMINE };
+
+struct reponse {
+    int type;
+    pid_t pid;
+    int val; // errno (DEMARRE) ou code de retour (TERMINE)
+};
+
+struct serveur {
+    pid_t pid;
+    int sock;
+    int encours; // commandes lancées mais pas encore attendues
+};
+
+static struct serveur *serveurs;
+static int nserveurs, prochain;
+
+// TERMINE reçus en attendant un DEMARRE, pas encore rendus à l'appelant
+static struct reponse *finis;
+static int nfinis, capfinis;
+
+static void init(void) {
+    const char *nom;
+
+    if (mode != -1)
+        return;
+    nom = getenv("LANCEMENT");
+    if (nom == NULL)
+        mode = L_FORK;
+    else if (lance_choisir(nom) == -1)
+        raler(0, "LANCEMENT=%s inconnu (fork, vfork, spawn, clone, pool)",
+              nom);
+}
+
+int lance_choisir(const char *nom) {
+    for (int i = 0; i < (int)(sizeof noms / sizeof noms[0]); i++) {
+        if (strcmp(nom, noms[i]) == 0) {
+            mode = i;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+const char *lance_nom(void) {
+    init();
+    return noms[mode];
+}
+
+// le fils d'un lance_fork() n'hérite ni des fils ni des serveurs
+static void oublier(void) {
+    for (int i = 0; i < nserveurs; i++)
+        close(serveurs[i].sock);
+    free(serveurs);
+    free(finis);
+    serveurs = NULL;
+    finis = NULL;
+    nserveurs = nfinis = capfinis = prochain = 0;
+    directs = 0;
+}
+
+pid_t lance_fork(void) {
+    pid_t pid;
+
+    init();
+    switch (pid = fork()) {
+    case -1:
+        return -1;
+    case 0:
+        oublier();
+        return 0;
+    default:
+        directs++;
+        return pid;
+    }
+}
+
+// dans le fils : pas de stdio ni de malloc (vfork, clone)
+static int rediriger(int entree, int sortie) {
+    if (entree != -1 && dup2(entree, 0) == -1)
+        return -1;
+    if (sortie != -1 && dup2(sortie, 1) == -1)
+        return -1;
+    return 0;
+}
+
+static int fils_clone(void *arg) {
+    struct tache *t = arg;
+
+    if (rediriger(t->entree, t->sortie) == 0)
+        execvp(t->argv[0], t->argv);
+    erreur_fils = errno;
+    _exit(127);
+}
+
+// le fils partagé a échoué avant son exec : le récupérer et rendre errno
+static pid_t bilan_partage(pid_t pid) {
+    if (pid == -1)
+        return -1;
+    if (erreur_fils != 0) {
+        while (waitpid(pid, NULL, 0) == -1 && errno == EINTR)
+            ;
+        errno = erreur_fils;
+        return -1;
+    }
+    directs++;
+    return pid;
+}
+
+static pid_t exec_spawn(char *const argv[], int entree, int sortie,
+                        const sigset_t *masque) {
+    posix_spawn_file_actions_t fa;
+    posix_spawnattr_t attr;
+    pid_t pid;
+    int err;
+
+    if ((err = posix_spawn_file_actions_init(&fa)) != 0 ||
+        (err = posix_spawnattr_init(&attr)) != 0)
+        raler(0, "posix_spawn init: %s", strerror(err));
+    if (entree != -1)
+        posix_spawn_file_actions_adddup2(&fa, entree, 0);
+    if (sortie != -1)
+        posix_spawn_file_actions_adddup2(&fa, sortie, 1);
+    if (masque != NULL) {
+        posix_spawnattr_setsigmask(&attr, masque);
+        posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSIGMASK);
+    }
+
+    err = posix_spawnp(&pid, argv[0], &fa, &attr, argv, environ);
+
+    posix_spawn_file_actions_destroy(&fa);
+    posix_spawnattr_destroy(&attr);
+    if (err != 0) {
+        errno = err;
+        return -1;
+    }
+    return pid;
+}
+
+static void envoyer(int sock, const struct reponse *r) {
+    if (send(sock, r, sizeof *r, MSG_NOSIGNAL) == -1)
+        exit(1); // l'appelant a disparu
+}
+
+/*
+ * Boucle d'un serveur : lancer les commandes reçues sur sock et signaler
+ * leur terminaison, jusqu'à la fermeture de la socket par l'appelant.
+ */
+static noreturn void serveur(int sock, const sigset_t *masque) {
+    static char buf[REQ_MAX];
+    char ctl[CMSG_SPACE(2 * sizeof(int))];
+    char *argv[REQ_MAX / 2 + 1];
+    struct requete req;
+    struct reponse rep;
+    struct iovec iov[2];
+    struct msghdr msg;
+    struct cmsghdr *cm;
+    struct pollfd pfd[2];
+    struct signalfd_siginfo si;
+    sigset_t fin;
+    int fds[2], nfds, sfd, raison;
+    ssize_t lu;
+    char *p;
+
+    if (prctl(PR_SET_PDEATHSIG, SIGKILL) == -1)
+        raler(1, "prctl");
+    if (sigemptyset(&fin) == -1 || sigaddset(&fin, SIGCHLD) == -1 ||
+        sigprocmask(SIG_BLOCK, &fin, NULL) == -1)
+        raler(1, "sigprocmask");
+    if ((sfd = signalfd(-1, &fin, SFD_CLOEXEC)) == -1)
+        raler(1, "signalfd");
+
+    pfd[0].fd = sock;
+    pfd[1].fd = sfd;
+    pfd[0].events = pfd[1].events = POLLIN;
+
+    for (;;) {
+        if (poll(pfd, 2, -1) == -1) {
+            if (errno == EINTR)
+                continue;
+            raler(1, "poll");
+        }
+
+        if (pfd[1].revents & POLLIN) {
+            if (read(sfd, &si, sizeof si) == -1)
+                raler(1, "read signalfd");
+            while ((rep.pid = waitpid(-1, &raison, WNOHANG)) > 0) {
+                rep.type = TERMINE;
+                rep.val = raison;
+                envoyer(sock, &rep);
+            }
+        }
+
+        if (pfd[0].revents & (POLLIN | POLLHUP)) {
+            iov[0].iov_base = &req;
+            iov[0].iov_len = sizeof req;
+            iov[1].iov_base = buf;
+            iov[1].iov_len = sizeof buf - 1;
+            memset(&msg, 0, sizeof msg);
+            msg.msg_iov = iov;
+            msg.msg_iovlen = 2;
+            msg.msg_control = ctl;
+            msg.msg_controllen = sizeof ctl;
+
+            if ((lu = recvmsg(sock, &msg, MSG_CMSG_CLOEXEC)) == -1) {
+                if (errno == EINTR)
+                    continue;
+                raler(1, "recvmsg");
+            }
+            if (lu == 0)
+                exit(0); // fin de l'appelant
+
+            nfds = 0;
+            cm = CMSG_FIRSTHDR(&msg);
+            if (cm != NULL && cm->cmsg_type == SCM_RIGHTS) {
+                nfds = (cm->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+                memcpy(fds, CMSG_DATA(cm), nfds * sizeof(int));
+            }
+            if (lu < (ssize_t)sizeof req || nfds != req.entree + req.sortie)
+                raler(0, "requête de lancement invalide");
+
+            // les chaînes se suivent, séparées par des octets nuls
+            buf[lu - sizeof req] = '\0';
+            p = buf;
+            for (int i = 0; i < req.argc; i++) {
+                argv[i] = p;
+                p += strlen(p) + 1;
+            }
+            argv[req.argc] = NULL;
+
+            rep.type = DEMARRE;
+            rep.pid = exec_spawn(argv, req.entree ? fds[0] : -1,
+                                 req.sortie ? fds[req.entree] : -1, masque);
+            rep.val = rep.pid == -1 ? errno : 0;
+            for (int i = 0; i < nfds; i++)
+                close(fds[i]);
+            envoyer(sock, &rep);
+        }
+    }
+}
+
+static void creer_serveurs(void) {
+    const char *s = getenv("LANCEMENT_POOL");
+    int n = s != NULL ? atoi(s) : POOL_DEFAUT;
+    int sv[2];
+    sigset_t masque;
+
+    if (n <= 0)
+        raler(0, "LANCEMENT_POOL=%s invalide", s);
+    if ((serveurs = malloc(n * sizeof *serveurs)) == NULL)
+        raler(1, "malloc");
+    // masque de l'appelant, rendu aux commandes lancées par le serveur
+    if (sigprocmask(SIG_SETMASK, NULL, &masque) == -1)
+        raler(1, "sigprocmask");
+
+    for (int i = 0; i < n; i++) {
+        if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, sv) == -1)
+            raler(1, "socketpair");
+        switch (serveurs[i].pid = fork()) {
+        case -1:
+            raler(1, "fork serveur");
+        case 0:
+            // ne garder que 0, 1, 2 et la socket (en 3)
+            if (dup2(sv[1], 3) == -1 || close_range(4, ~0U, 0) == -1 ||
+                fcntl(3, F_SETFD, FD_CLOEXEC) == -1)
+                raler(1, "serveur de lancement");
+            serveur(3, &masque);
+        default:
+            break;
+        }
+        if (close(sv[1]) == -1)
+            raler(1, "close");
+        serveurs[i].sock = sv[0];
+        serveurs[i].encours = 0;
+        nserveurs++;
+    }
+}
+
+static void recevoir(struct serveur *s, struct reponse *r) {
+    ssize_t lu;
+
+    while ((lu = recv(s->sock, r, sizeof *r, 0)) == -1 && errno == EINTR)
+        ;
+    if (lu == -1)
+        raler(1, "recv serveur %d", s->pid);
+    if (lu != sizeof *r)
+        raler(0, "serveur de lancement %d terminé", s->pid);
+    if (r->type == TERMINE) {
+        s->encours--;
+        if (nfinis == capfinis) {
+            capfinis = capfinis == 0 ? 16 : 2 * capfinis;
+            if ((finis = realloc(finis, capfinis * sizeof *finis)) == NULL)
+                raler(1, "realloc");
+        }
+        finis[nfinis++] = *r;
+    }
+}
+
+void lance_init(void) {
+    init();
+    if (mode == L_POOL && nserveurs == 0)
+        creer_serveurs();
+}
+
+static pid_t exec_pool(char *const argv[], int entree, int sortie) {
+    static char buf[REQ_MAX];
+    char ctl[CMSG_SPACE(2 * sizeof(int))];
+    struct requete req = {entree != -1, sortie != -1, 0};
+    struct iovec iov[2];
+    struct msghdr msg;
+    struct cmsghdr *cm;
+    struct reponse rep;
+    struct serveur *s;
+    size_t l, taille = 0;
+    int fds[2], nfds = 0;
+
+    if (nserveurs == 0)
+        creer_serveurs(); // lance_init() n'a pas été appelée
+    s = &serveurs[prochain];
+    prochain = (prochain + 1) % nserveurs;
+
+    for (; argv[req.argc] != NULL; req.argc++) {
+        l = strlen(argv[req.argc]) + 1;
+        if (taille + l >= sizeof buf) {
+            errno = E2BIG;
+            return -1;
+        }
+        memcpy(buf + taille, argv[req.argc], l);
+        taille += l;
+    }
+
+    iov[0].iov_base = &req;
+    iov[0].iov_len = sizeof req;
+    iov[1].iov_base = buf;
+    iov[1].iov_len = taille;
+    memset(&msg, 0, sizeof msg);
+    msg.msg_iov = iov;
+    msg.msg_iovlen = 2;
+
+    if (entree != -1)
+        fds[nfds++] = entree;
+    if (sortie != -1)
+        fds[nfds++] = sortie;
+    if (nfds > 0) {
+        msg.msg_control = ctl;
+        msg.msg_controllen = CMSG_SPACE(nfds * sizeof(int));
+        cm = CMSG_FIRSTHDR(&msg);
+        cm->cmsg_level = SOL_SOCKET;
+        cm->cmsg_type = SCM_RIGHTS;
+        cm->cmsg_len = CMSG_LEN(nfds * sizeof(int));
+        memcpy(CMSG_DATA(cm), fds, nfds * sizeof(int));
+    }
+
+    while (sendmsg(s->sock, &msg, MSG_NOSIGNAL) == -1)
+        if (errno != EINTR)
+            raler(1, "sendmsg serveur %d", s->pid);
+
+    // des TERMINE d'autres commandes peuvent précéder la réponse
+    do
+        recevoir(s, &rep);
+    while (rep.type != DEMARRE);
+
+    if (rep.pid == -1) {
+        errno = rep.val;
+        return -1;
+    }
+    s->encours++;
+    return rep.pid;
+}
+
+pid_t lance_exec(char *const argv[], int entree, int sortie) {
+    struct tache t = {argv, entree, sortie};
+    pid_t pid;
+
+    init();
+    switch (mode) {
+    case L_VFORK:
+        erreur_fils = 0;
+        if ((pid = vfork()) == 0) {
+            if (rediriger(entree, sortie) == 0)
+                execvp(argv[0], argv);
+            erreur_fils = errno;
+            _exit(127);
+        }
+        return bilan_partage(pid);
+
+    case L_CLONE:
+        erreur_fils = 0;
+        pid = clone(fils_clone, pile + sizeof pile,
+                    CLONE_VM | CLONE_VFORK | SIGCHLD, &t);
+        return bilan_partage(pid);
+
+    case L_SPAWN:
+        if ((pid = exec_spawn(argv, entree, sortie, NULL)) != -1)
+            directs++;
+        return pid;
+
+    case L_POOL:
+        return exec_pool(argv, entree, sortie);
+
+    default:
+        switch (pid = fork()) {
+        case -1:
+            return -1;
+        case 0:
+            if (rediriger(entree, sortie) == -1)
+                raler(1, "dup2");
+            execvp(argv[0], argv);
+            raler(1, "exec %s", argv[0]);
+        default:
+            directs++;
+            return pid;
+        }
+    }
+}
+
+pid_t lance_attendre(int *raison) {
+    struct pollfd pfd[nserveurs > 0 ? nserveurs : 1];
+    struct reponse rep;
+    pid_t pid;
+    int encours, np;
+
+    for (;;) {
+        if (nfinis > 0) {
+            rep = finis[--nfinis];
+            *raison = rep.val;
+            return rep.pid;
+        }
+
+        encours = 0;
+        for (int i = 0; i < nserveurs; i++)
+            encours += serveurs[i].encours;
+
+        if (encours == 0 || directs > 0) {
+            if (directs == 0 && encours == 0) {
+                errno = ECHILD;
+                return -1;
+            }
+            pid = waitpid(-1, raison, encours == 0 ? 0 : WNOHANG);
+            if (pid == -1)
+                return -1;
+            if (pid > 0) {
+                for (int i = 0; i < nserveurs; i++)
+                    if (pid == serveurs[i].pid)
+                        raler(0, "serveur de lancement %d terminé", pid);
+                directs--;
+                return pid;
+            }
+        }
+
+        np = 0;
+        for (int i = 0; i < nserveurs; i++) {
+            if (serveurs[i].encours > 0) {
+                pfd[np].fd = serveurs[i].sock;
+                pfd[np++].events = POLLIN;
+            }
+        }
+        if (poll(pfd, np, directs > 0 ? SONDE_MS : -1) == -1) {
+            if (errno == EINTR)
+                continue;
+            raler(1, "poll");
+        }
+        for (int i = 0, j = 0; i < nserveurs; i++) {
+            if (serveurs[i].encours > 0 && pfd[j++].revents != 0)
+                recevoir(&serveurs[i], &rep);
+        }
+    }
+}
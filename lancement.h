@@ -0,0 +1,52 @@
+#ifndef LANCEMENT_H
+#define LANCEMENT_H
+
+#include <stdnoreturn.h>
+#include <sys/types.h>
+
+/*
+ * Création de processus commune à majus, poly, prodscal et rondeur.
+ *
+ * Le mécanisme est choisi par la variable d'environnement LANCEMENT
+ * (ou lance_choisir()) :
+ * - fork : fork puis exec, comme auparavant (par défaut) ;
+ * - vfork : vfork puis exec, sans copie des tables de pages ;
+ * - spawn : posix_spawnp ;
+ * - clone : clone(CLONE_VM | CLONE_VFORK) sur une pile dédiée ;
+ * - pool : serveurs de lancement (LANCEMENT_POOL, 2 par défaut), petits
+ *   donc rapides à dupliquer, qui reçoivent les commandes et les
+ *   descripteurs par socket et sont réutilisés d'une commande à l'autre.
+ *   Ils sont créés par lance_init(), à appeler au début de main tant que
+ *   le programme est encore petit, sinon au premier lance_exec(). Le fils
+ *   d'un lance_fork() n'hérite pas des serveurs de son père : il crée
+ *   les siens à son premier lance_exec().
+ *
+ * Seul lance_exec() bénéficie de ces variantes. lance_fork(), pour les
+ * fils qui exécutent du code du programme, reste un fork() : vfork et
+ * clone(CLONE_VM) suspendraient le père, posix_spawn impose un exec.
+ *
+ * Avec les serveurs, les commandes ne sont pas des fils de l'appelant :
+ * il faut attendre tous les processus lancés avec lance_attendre() et
+ * non wait().
+ */
+
+// lit LANCEMENT et, pour pool, crée les serveurs
+void lance_init(void);
+
+// sur le modèle de fork() : 0 dans le fils, pid du fils dans le père
+pid_t lance_fork(void);
+
+// exécute argv[0] (cherché dans PATH) avec entree et sortie comme
+// descripteurs 0 et 1 (-1 : hérités) ; renvoie le pid, ou -1 et errno
+pid_t lance_exec(char *const argv[], int entree, int sortie);
+
+// sur le modèle de wait() : -1 et ECHILD s'il n'y a rien à attendre
+pid_t lance_attendre(int *raison);
+
+int lance_choisir(const char *nom); // -1 si le nom est inconnu
+const char *lance_nom(void);
+
+// fournie par le programme : affiche le message et termine le processus
+noreturn void raler(int syserr, const char *fmt, ...);
+
+#endif
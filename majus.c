@@ -1,6 +1,8 @@
-#include <dirent.h>
+#define _GNU_SOURCE // pipe2
+
 #include <errno.h>
 #include <fcntl.h>
+#include <inttypes.h>
 #include <stdarg.h>
 #include <stdint.h>
 #include <stdio.h>
@@ -10,8 +12,12 @@
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <sys/wait.h>
+#include <time.h>
 #include <unistd.h>
 
+#include "lancement.h"
+#include "parcours.h"
+
 #define CHK(op)                                                                \
     do {                                                                       \
         if ((op) == -1)                                                        \
@@ -24,6 +30,17 @@
     } while (0)
 
 #define CHEMIN_MAX 128
+#define MAXBUF 4096
+
+#define USAGE                                                                  \
+    "usage: majus [-u [-c]] src dst\n"                                      \
+    "       majus -t archive|- [-z] src dst"
+
+#define MANIFESTE ".majus" // dans dst, en mode mise à jour
+
+#define BLOC 512               // bloc tar
+#define ENREGISTREMENT (20 * BLOC) // taille de l'archive : multiple de
+#define ARCH_BUF (1024 * 1024) // écritures séquentielles de l'archive
 
 noreturn void raler(int syserr, const char *fmt, ...) {
     va_list ap;
@@ -45,91 +62,624 @@ void concatener(char str[CHEMIN_MAX + 1], const char *dir, const char *fich) {
         raler(0, "trop long: %s/%s", dir, fich);
 }
 
-void majusculation(const char *src, const char *dst, mode_t perm) {
+/*
+ * Mode mise à jour (-u) : dst peut exister. Un manifeste dst/.majus
+ * garde, pour chaque fichier converti, la taille et la date de
+ * modification de sa source (et son empreinte CRC32C avec -c).
+ * - un premier parcours de dst supprime les fichiers du manifeste qui
+ *   n'ont plus de source (ou plus une source du même type), et les
+ *   répertoires ainsi vidés ; le reste de dst n'est pas touché ;
+ * - le parcours de src ne convertit que les fichiers nouveaux ou dont
+ *   la source a changé ; avec -c, une source de même contenu (simple
+ *   touch) n'est pas reconvertie ;
+ * - les permissions sont réappliquées partout, et un résumé affiché.
+ */
+struct fiche {
+    char chemin[CHEMIN_MAX + 1]; // relatif à la racine
+    off_t taille;
+    struct timespec mtime;
+    int avec_crc;
+    uint32_t crc;
+};
+
+#define TABDYN_INCREMENT 50 // on alloue ce nb d'entrées à chaque fois
+struct manifeste {
+    int dim;           // dimension du tableau (taille allocation)
+    int nbent;         // nombre d'entrées actuellement utilisées
+    struct fiche *tab; // le tableau lui-même
+};
+
+/*
+ * Mode archive (-t) : au lieu de créer un fichier par source, l'arbre
+ * converti est écrit en un seul flux tar (ustar) dans un fichier ou
+ * sur la sortie standard, par écritures de ARCH_BUF octets. La
+ * conversion est faite dans le processus, sans lancer tr ; avec -z, le
+ * flux passe par "zstd -c" lancé par la couche de lancement. Les
+ * répertoires sont archivés avant leur contenu, avec leurs permissions
+ * (tar ne les applique qu'après l'extraction de ce contenu).
+ */
+struct archive {
+    int fd;         // fichier, sortie standard ou tube vers zstd
+    int compresse;  // un fils zstd à attendre
+    char *buf;
+    size_t n;       // octets en attente dans buf
+    off_t total;
+};
+
+// les sous-répertoires en cours : un seul par profondeur (ordre en profondeur)
+struct majus {
+    const char *src, *dst;
+    size_t lsrc, ldst;
+    int nfils[CHEMIN_MAX / 2 + 1]; // fichiers lancés par profondeur
+    int retires[CHEMIN_MAX / 2 + 1]; // entrées supprimées par profondeur
+    int maj, empreinte;            // options -u et -c
+    struct manifeste ancien, nouveau;
+    int convertis, inchanges, supprimes;
+    struct archive *arch; // mode archive, sinon NULL
+};
+
+uint32_t crc_table[256];
+
+void crc_init(void) {
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t c = i;
+        for (int k = 0; k < 8; k++)
+            c = c & 1 ? (c >> 1) ^ 0x82f63b78 : c >> 1;
+        crc_table[i] = c;
+    }
+}
+
+// CRC32C du contenu d'un fichier
+uint32_t crc_fichier(const struct parc_entree *e) {
+    unsigned char buf[MAXBUF];
+    uint32_t crc = ~(uint32_t)0;
+    ssize_t nlus;
     int fd;
 
-    switch (fork()) {
-    case -1:
-        raler(1, "fork sur %s", src);
+    CHK(fd = openat(e->dirfd, e->nom, O_RDONLY | O_NOFOLLOW));
+    while ((nlus = read(fd, buf, sizeof buf)) > 0)
+        for (ssize_t i = 0; i < nlus; i++)
+            crc = crc_table[(crc ^ buf[i]) & 0xff] ^ (crc >> 8);
+    CHK(nlus);
+    CHK(close(fd));
+    return ~crc;
+}
+
+void man_init(struct manifeste *t) {
+    t->dim = t->nbent = 0;
+    t->tab = NULL;
+}
+
+void man_add(struct manifeste *t, const struct fiche *f) {
+    if (t->nbent >= t->dim) {
+        t->dim += TABDYN_INCREMENT;
+        CHKN(t->tab = realloc(t->tab, t->dim * sizeof(struct fiche)));
+    }
+    t->tab[t->nbent++] = *f;
+}
 
-    case 0:
-        // redirection entrée standard depuis "src"
-        CHK(fd = open(src, O_RDONLY));
-        CHK(dup2(fd, 0));
-        CHK(close(fd));
+int compare(const void *v1, const void *v2) {
+    const struct fiche *f1 = v1;
+    const struct fiche *f2 = v2;
 
-        // redirection sortie standard vers "dst"
-        CHK(fd = open(dst, O_WRONLY | O_CREAT | O_TRUNC, 0666));
-        CHK(fchmod(fd, perm));
-        CHK(dup2(fd, 1));
-        CHK(close(fd));
+    return strcmp(f1->chemin, f2->chemin);
+}
+
+const struct fiche *man_chercher(const struct manifeste *t, const char *rel) {
+    struct fiche cle;
+
+    if (t->nbent == 0)
+        return NULL;
+    strcpy(cle.chemin, rel);
+    return bsearch(&cle, t->tab, t->nbent, sizeof(struct fiche), compare);
+}
+
+void man_destroy(struct manifeste *t) {
+    free(t->tab);
+    man_init(t);
+}
+
+// une ligne par fichier : taille sec nsec crc|- chemin
+void man_lire(struct manifeste *t, const char *dst) {
+    char nom[CHEMIN_MAX + 1], crc[9], *ligne = NULL;
+    size_t taille = 0;
+    intmax_t tl, sec;
+    long nsec;
+    ssize_t l;
+    struct fiche f;
+    FILE *fp;
+    int pos;
+
+    concatener(nom, dst, MANIFESTE);
+    if ((fp = fopen(nom, "r")) == NULL) {
+        if (errno == ENOENT) // pas encore de manifeste : tout convertir
+            return;
+        raler(1, "fopen %s", nom);
+    }
+    while ((l = getline(&ligne, &taille, fp)) != -1) {
+        if (l > 0 && ligne[l - 1] == '\n')
+            ligne[--l] = '\0';
+        if (sscanf(ligne, "%jd %jd %ld %8s %n", &tl, &sec, &nsec, crc, &pos) !=
+                4 ||
+            strlen(ligne + pos) > CHEMIN_MAX)
+            raler(0, "%s : ligne invalide : %s", nom, ligne);
+        strcpy(f.chemin, ligne + pos);
+        f.taille = tl;
+        f.mtime.tv_sec = sec;
+        f.mtime.tv_nsec = nsec;
+        f.avec_crc = strcmp(crc, "-") != 0;
+        f.crc = f.avec_crc ? (uint32_t)strtoul(crc, NULL, 16) : 0;
+        man_add(t, &f);
+    }
+    if (ferror(fp))
+        raler(1, "getline %s", nom);
+    free(ligne);
+    CHK(fclose(fp) == EOF ? -1 : 0);
+    qsort(t->tab, t->nbent, sizeof(struct fiche), compare);
+}
 
-        execlp("tr", "tr", "a-z", "A-Z", NULL);
-        raler(1, "exec tr %s", src);
+// écrit sous un nom temporaire puis renomme : jamais de manifeste partiel
+void man_ecrire(const struct manifeste *t, const char *dst) {
+    char nom[CHEMIN_MAX + 1], tmp[CHEMIN_MAX + 1];
+    FILE *fp;
 
-    default:
-        break;
+    concatener(nom, dst, MANIFESTE);
+    concatener(tmp, dst, MANIFESTE ".tmp");
+    CHKN(fp = fopen(tmp, "w"));
+    for (int i = 0; i < t->nbent; i++) {
+        const struct fiche *f = &t->tab[i];
+        fprintf(fp, "%jd %jd %ld ", (intmax_t)f->taille,
+                (intmax_t)f->mtime.tv_sec, f->mtime.tv_nsec);
+        if (f->avec_crc)
+            fprintf(fp, "%08" PRIx32, f->crc);
+        else
+            fprintf(fp, "-");
+        fprintf(fp, " %s\n", f->chemin);
     }
+    CHK(fclose(fp) == EOF ? -1 : 0);
+    CHK(rename(tmp, nom));
 }
 
-void parcourir(const char *src, const char *dst, mode_t permrep) {
-    DIR *dp;
-    struct dirent *d;
-    char nsrc[CHEMIN_MAX + 1], ndst[CHEMIN_MAX + 1];
+// chemin de e relatif à la racine de longueur l (sans '/' de tête)
+const char *relatif(const struct parc_entree *e, size_t l) {
+    const char *r = e->chemin + l;
+
+    while (*r == '/')
+        r++;
+    return r;
+}
+
+// chemin destination correspondant à l'entrée e de la source
+void destination(char ndst[CHEMIN_MAX + 1], const struct majus *m,
+                 const struct parc_entree *e) {
+    if (e->profondeur > 0)
+        concatener(ndst, m->dst, relatif(e, m->lsrc));
+    else if (strlen(m->dst) > CHEMIN_MAX)
+        raler(0, "trop long: %s", m->dst);
+    else
+        strcpy(ndst, m->dst);
+}
+
+void majusculation(const struct parc_entree *e, const char *dst) {
+    char *tr[] = {"tr", "a-z", "A-Z", NULL};
     struct stat stbuf;
+    int in, out;
+
+    // redirections préparées par le père : le fils n'a plus qu'à exécuter
+    // tr, quel que soit le mode de lancement
+    CHK(in = openat(e->dirfd, e->nom, O_RDONLY | O_NOFOLLOW | O_CLOEXEC));
+    CHK(fstat(in, &stbuf));
+    CHK(out = open(dst, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666));
+    CHK(fchmod(out, stbuf.st_mode & 0777));
+
+    if (lance_exec(tr, in, out) == -1)
+        raler(1, "exec tr %s", e->chemin);
+
+    CHK(close(in));
+    CHK(close(out));
+}
+
+void arch_vider(struct archive *a) {
+    ssize_t n;
+
+    for (size_t fait = 0; fait < a->n; fait += n)
+        CHK(n = write(a->fd, a->buf + fait, a->n - fait));
+    a->n = 0;
+}
+
+// réserve n octets (n <= ARCH_BUF) dans le tampon de l'archive
+char *arch_place(struct archive *a, size_t n) {
+    char *p;
+
+    if (a->n + n > ARCH_BUF)
+        arch_vider(a);
+    p = a->buf + a->n;
+    a->n += n;
+    a->total += n;
+    return p;
+}
+
+void arch_ouvrir(struct archive *a, const char *nom, int compresse) {
+    char *zstd[] = {"zstd", "-q", "-c", NULL};
+    int tube[2], fd;
+
+    if (strcmp(nom, "-") == 0)
+        fd = 1;
+    else
+        CHK(fd = open(nom, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666));
+
+    a->compresse = compresse;
+    if (compresse) {
+        CHK(pipe2(tube, O_CLOEXEC));
+        if (lance_exec(zstd, tube[0], fd) == -1)
+            raler(1, "exec zstd");
+        CHK(close(tube[0]));
+        if (fd != 1)
+            CHK(close(fd));
+        fd = tube[1];
+    }
+    a->fd = fd;
+    CHKN(a->buf = malloc(ARCH_BUF));
+    a->n = 0;
+    a->total = 0;
+}
+
+// deux blocs nuls, complétés jusqu'à un multiple de ENREGISTREMENT
+void arch_fermer(struct archive *a) {
     int raison;
-    int nfils;
-
-    CHKN(dp = opendir(src));
-    CHK(mkdir(dst, 0777));
-
-    // toute la lecture
-    nfils = 0;
-    errno = 0;
-    while ((d = readdir(dp)) != NULL) {
-        if (strcmp(d->d_name, ".") != 0 && strcmp(d->d_name, "..") != 0) {
-            concatener(nsrc, src, d->d_name);
-            concatener(ndst, dst, d->d_name);
-
-            CHK(lstat(nsrc, &stbuf));
-            switch (stbuf.st_mode & S_IFMT) {
-            case S_IFDIR:
-                parcourir(nsrc, ndst, stbuf.st_mode & 0777);
-                break;
-            case S_IFREG:
-                majusculation(nsrc, ndst, stbuf.st_mode & 0777);
-                nfils++;
-                break;
-            default:
-                // ignorer les autres cas (y compris les liens symboliques)
+    size_t fin = 2 * BLOC;
+
+    fin += (ENREGISTREMENT - (a->total + fin) % ENREGISTREMENT) %
+           ENREGISTREMENT;
+    memset(arch_place(a, fin), 0, fin);
+    arch_vider(a);
+    if (a->fd != 1)
+        CHK(close(a->fd));
+    if (a->compresse) {
+        CHK(lance_attendre(&raison));
+        if (!(WIFEXITED(raison) && WEXITSTATUS(raison) == 0))
+            raler(0, "zstd mal terminé");
+    }
+    free(a->buf);
+}
+
+// nombre en octal sur l (chiffres + NUL), base 256 (GNU) s'il déborde
+void octal(char *champ, size_t l, uintmax_t v) {
+    if (v >> (3 * (l - 1)) == 0) {
+        snprintf(champ, l, "%0*jo", (int)(l - 1), v);
+        return;
+    }
+    for (size_t i = l - 1; i > 0; i--, v >>= 8)
+        champ[i] = v & 0xff;
+    champ[0] = (char)0x80;
+}
+
+// en-tête ustar : le chemin est coupé en préfixe / nom si besoin
+void arch_entete(struct archive *a, const char *chemin, int rep,
+                 const struct stat *st) {
+    char *h = arch_place(a, BLOC);
+    size_t l = strlen(chemin) + rep, coupe = 0;
+    unsigned somme = 0;
+
+    memset(h, 0, BLOC);
+    if (l > 100) {
+        // premier '/' laissant au plus 100 octets au nom
+        for (coupe = 1; chemin[coupe] != '\0'; coupe++)
+            if (chemin[coupe] == '/' && l - coupe - 1 <= 100)
                 break;
-            }
+        if (chemin[coupe] == '\0' || coupe > 155)
+            raler(0, "nom trop long pour tar: %s", chemin);
+        memcpy(h + 345, chemin, coupe);
+        chemin += coupe + 1;
+    }
+    memcpy(h, chemin, strlen(chemin));
+    if (rep)
+        h[strlen(chemin)] = '/';
+
+    octal(h + 100, 8, st->st_mode & 0777);
+    octal(h + 108, 8, st->st_uid);
+    octal(h + 116, 8, st->st_gid);
+    octal(h + 124, 12, rep ? 0 : st->st_size);
+    octal(h + 136, 12, st->st_mtim.tv_sec);
+    h[156] = rep ? '5' : '0';
+    memcpy(h + 257, "ustar", 6);
+    memcpy(h + 263, "00", 2);
+
+    memset(h + 148, ' ', 8);
+    for (int i = 0; i < BLOC; i++)
+        somme += (unsigned char)h[i];
+    snprintf(h + 148, 8, "%06o", somme);
+}
+
+// le contenu converti directement dans le tampon de l'archive
+void arch_fichier(struct archive *a, const struct parc_entree *e,
+                  const char *chemin) {
+    struct stat st;
+    off_t reste;
+    ssize_t nlus;
+    size_t n;
+    char *p;
+    int fd;
+
+    CHK(fd = openat(e->dirfd, e->nom, O_RDONLY | O_NOFOLLOW | O_CLOEXEC));
+    CHK(fstat(fd, &st));
+    arch_entete(a, chemin, 0, &st);
+
+    for (reste = st.st_size; reste > 0; reste -= nlus) {
+        n = reste < MAXBUF * 16 ? reste : MAXBUF * 16;
+        p = arch_place(a, n);
+        CHK(nlus = read(fd, p, n));
+        if (nlus == 0)
+            raler(0, "%s : fichier raccourci pendant la lecture", e->chemin);
+        for (ssize_t i = 0; i < nlus; i++)
+            if (p[i] >= 'a' && p[i] <= 'z')
+                p[i] -= 'a' - 'A';
+        // lecture partielle : rendre ce qui n'a pas été lu
+        a->n -= n - nlus;
+        a->total -= n - nlus;
+    }
+    n = (BLOC - st.st_size % BLOC) % BLOC;
+    memset(arch_place(a, n), 0, n);
+    CHK(close(fd));
+}
+
+void avant_rep(const struct parc_entree *e, void *arg) {
+    struct majus *m = arg;
+    char ndst[CHEMIN_MAX + 1];
+
+    destination(ndst, m, e);
+    if (m->arch != NULL) {
+        arch_entete(m->arch, ndst, 1, e->st);
+        return;
+    }
+    if (mkdir(ndst, 0777) == -1) {
+        // mise à jour : répertoire déjà là, le rendre modifiable
+        // jusqu'à apres_rep
+        if (!m->maj || errno != EEXIST)
+            raler(1, "mkdir %s", ndst);
+        CHK(chmod(ndst, 0700));
+    }
+    m->nfils[e->profondeur] = 0;
+}
+
+/*
+ * Mise à jour : le fichier destination est-il à jour ? Renseigne la
+ * fiche f à mettre dans le nouveau manifeste.
+ */
+int a_jour(struct majus *m, const struct parc_entree *e, const char *ndst,
+           struct fiche *f) {
+    const struct fiche *a;
+    struct stat st;
+
+    strcpy(f->chemin, relatif(e, m->lsrc));
+    f->taille = e->st->st_size;
+    f->mtime = e->st->st_mtim;
+    f->avec_crc = 0;
+
+    if ((a = man_chercher(&m->ancien, f->chemin)) == NULL)
+        return 0;
+    if (fstatat(AT_FDCWD, ndst, &st, AT_SYMLINK_NOFOLLOW) == -1) {
+        if (errno != ENOENT)
+            raler(1, "stat %s", ndst);
+        return 0;
+    }
+    if (!S_ISREG(st.st_mode) || st.st_size != f->taille)
+        return 0;
+
+    if (a->taille == f->taille && a->mtime.tv_sec == f->mtime.tv_sec &&
+        a->mtime.tv_nsec == f->mtime.tv_nsec) {
+        f->avec_crc = a->avec_crc;
+        f->crc = a->crc;
+        if (m->empreinte && !f->avec_crc) {
+            // amorcer l'empreinte pour les prochaines mises à jour
+            f->avec_crc = 1;
+            f->crc = crc_fichier(e);
         }
+        return 1;
+    }
+    // date changée : le contenu l'est-il vraiment ?
+    if (m->empreinte && a->avec_crc) {
+        f->avec_crc = 1;
+        f->crc = crc_fichier(e);
+        return f->crc == a->crc;
+    }
+    return 0;
+}
+
+void entree(const struct parc_entree *e, void *arg) {
+    struct majus *m = arg;
+    char ndst[CHEMIN_MAX + 1];
+    struct fiche f;
+
+    // ignorer les autres cas (y compris les liens symboliques)
+    if (e->type != PARC_FICHIER)
+        return;
+
+    destination(ndst, m, e);
+    if (m->arch != NULL) {
+        arch_fichier(m->arch, e, ndst);
+        return;
+    }
+    if (!m->maj) {
+        majusculation(e, ndst);
+        m->nfils[e->profondeur - 1]++;
+        return;
+    }
 
-        errno = 0;
+    if (a_jour(m, e, ndst, &f)) {
+        CHK(chmod(ndst, e->st->st_mode & 0777));
+        m->inchanges++;
+    } else {
+        // l'ancienne version peut être en lecture seule
+        if (unlink(ndst) == -1 && errno != ENOENT)
+            raler(1, "unlink %s", ndst);
+        majusculation(e, ndst);
+        m->nfils[e->profondeur - 1]++;
+        if (m->empreinte && !f.avec_crc) {
+            f.avec_crc = 1;
+            f.crc = crc_fichier(e);
+        }
+        m->convertis++;
     }
-    if (errno != 0)
-        raler(1, "readdir");
+    man_add(&m->nouveau, &f);
+}
 
-    CHK(closedir(dp));
+// répertoire et sous-répertoires terminés : attendre ses fils, puis
+// seulement restaurer ses permissions
+void apres_rep(const struct parc_entree *e, void *arg) {
+    struct majus *m = arg;
+    char ndst[CHEMIN_MAX + 1];
+    int raison;
 
-    for (int i = 0; i < nfils; i++) {
-        CHK(wait(&raison));
+    if (m->arch != NULL)
+        return;
+    for (int i = 0; i < m->nfils[e->profondeur]; i++) {
+        CHK(lance_attendre(&raison));
         if (!(WIFEXITED(raison) && WEXITSTATUS(raison) == 0))
             raler(0, "fils mal terminé");
     }
 
-    CHK(chmod(dst, permrep));
+    destination(ndst, m, e);
+    // le manifeste avant que la racine ne redevienne non modifiable
+    if (m->maj && e->profondeur == 0)
+        man_ecrire(&m->nouveau, m->dst);
+    CHK(chmod(ndst, e->st->st_mode & 0777));
 }
 
-int main(int argc, const char *argv[]) {
-    struct stat stbuf;
+/*
+ * Parcours de dst (mise à jour) : seul un fichier inscrit dans l'ancien
+ * manifeste, dont la source n'existe plus ou n'est plus un fichier, est
+ * supprimé, ainsi qu'un répertoire sans source vidé par ces
+ * suppressions. Le reste de dst (fichiers qui ne viennent pas de majus,
+ * dst sans manifeste) n'est jamais touché. Les répertoires sont rendus
+ * modifiables le temps du parcours.
+ */
+int a_une_source(const struct majus *m, const struct parc_entree *e,
+                 mode_t type) {
+    char nsrc[CHEMIN_MAX + 1];
+    struct stat st;
+
+    concatener(nsrc, m->src, relatif(e, m->ldst));
+    if (lstat(nsrc, &st) == -1) {
+        if (errno != ENOENT && errno != ENOTDIR)
+            raler(1, "lstat %s", nsrc);
+        return 0;
+    }
+    return (st.st_mode & S_IFMT) == type;
+}
+
+void orph_avant(const struct parc_entree *e, void *arg) {
+    struct majus *m = arg;
+
+    if ((e->st->st_mode & 0700) != 0700)
+        CHK(fchmod(e->fd, (e->st->st_mode & 0777) | 0700));
+    m->retires[e->profondeur] = 0;
+}
+
+void orph_entree(const struct parc_entree *e, void *arg) {
+    struct majus *m = arg;
+
+    if (e->type != PARC_FICHIER ||
+        man_chercher(&m->ancien, relatif(e, m->ldst)) == NULL)
+        return;
+    if (!a_une_source(m, e, S_IFREG)) {
+        CHK(unlinkat(e->dirfd, e->nom, 0));
+        m->retires[e->profondeur - 1]++;
+        m->supprimes++;
+    }
+}
+
+void orph_apres(const struct parc_entree *e, void *arg) {
+    struct majus *m = arg;
+
+    if (e->profondeur == 0 || a_une_source(m, e, S_IFDIR))
+        return; // permissions restaurées par le parcours de src
+    // vidé par nos suppressions : le supprimer, sinon le laisser tel quel
+    if (m->retires[e->profondeur] > 0) {
+        if (unlinkat(e->dirfd, e->nom, AT_REMOVEDIR) == 0) {
+            m->retires[e->profondeur - 1]++;
+            m->supprimes++;
+            return;
+        }
+        if (errno != ENOTEMPTY && errno != EEXIST)
+            raler(1, "rmdir %s", e->chemin);
+    }
+    CHK(fchmodat(e->dirfd, e->nom, e->st->st_mode & 0777, 0));
+}
+
+int main(int argc, char *argv[]) {
+    struct parcours p;
+    struct majus m;
+    struct stat st;
+    struct archive a;
+    const char *archive = NULL;
+    int opt, compresse = 0;
+
+    lance_init(); // serveurs de lancement avant toute allocation
+    m.maj = m.empreinte = 0;
+    while ((opt = getopt(argc, argv, "uct:z")) != -1) {
+        switch (opt) {
+        case 'u':
+            m.maj = 1;
+            break;
+        case 'c':
+            m.empreinte = 1;
+            break;
+        case 't':
+            archive = optarg;
+            break;
+        case 'z':
+            compresse = 1;
+            break;
+        default:
+            raler(0, USAGE);
+        }
+    }
+    if (argc - optind != 2 || (m.empreinte && !m.maj) ||
+        (compresse && archive == NULL) || (m.maj && archive != NULL))
+        raler(0, USAGE);
+
+    m.src = argv[optind];
+    m.dst = argv[optind + 1];
+    m.lsrc = strlen(m.src);
+    m.ldst = strlen(m.dst);
+    m.convertis = m.inchanges = m.supprimes = 0;
+    man_init(&m.ancien);
+    man_init(&m.nouveau);
+    crc_init();
+    m.arch = NULL;
+    if (archive != NULL) {
+        arch_ouvrir(&a, archive, compresse);
+        m.arch = &a;
+    }
+
+    if (m.maj && stat(m.dst, &st) == 0) {
+        man_lire(&m.ancien, m.dst);
+        parc_init(&p, CHEMIN_MAX);
+        p.avant_rep = orph_avant;
+        p.entree = orph_entree;
+        p.apres_rep = orph_apres;
+        p.arg = &m;
+        parc_lancer(&p, m.dst);
+    }
 
-    if (argc != 3)
-        raler(0, "usage: majus src dst");
+    // ordre en profondeur : les permissions d'un répertoire ne sont
+    // restaurées qu'après celles de ses sous-répertoires
+    parc_init(&p, CHEMIN_MAX);
+    p.stat = m.maj; // taille et date des sources
+    p.avant_rep = avant_rep;
+    p.entree = entree;
+    p.apres_rep = apres_rep;
+    p.arg = &m;
+    parc_lancer(&p, m.src);
 
-    CHK(stat(argv[1], &stbuf));
-    parcourir(argv[1], argv[2], stbuf.st_mode & 0777);
+    if (m.arch != NULL)
+        arch_fermer(m.arch);
+    if (m.maj)
+        printf("%d convertis, %d inchangés, %d supprimés\n", m.convertis,
+               m.inchanges, m.supprimes);
+    man_destroy(&m.ancien);
+    man_destroy(&m.nouveau);
 
     exit(0);
 }
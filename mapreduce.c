@@ -0,0 +1,293 @@
+#define _GNU_SOURCE // MAP_ANONYMOUS
+
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdalign.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "collectif.h"
+#include "lancement.h"
+#include "mapreduce.h"
+
+#define CHK(op)                                                                \
+    do {                                                                       \
+        if ((op) == -1)                                                        \
+            raler(1, #op);                                                     \
+    } while (0)
+
+// les fonctions pthread_* renvoient le code d'erreur au lieu de -1
+#define CHKT(op)                                                               \
+    do {                                                                       \
+        if ((errno = (op)) != 0)                                               \
+            raler(1, #op);                                                     \
+    } while (0)
+
+#define CHKN(op)                                                               \
+    do {                                                                       \
+        if ((op) == NULL)                                                      \
+            raler(1, #op);                                                     \
+    } while (0)
+
+static const char *noms[] = {"tube", "shm", "threads"};
+
+size_t mr_lot = 0;
+
+int mr_choisir(const char *nom) {
+    for (int t = MR_TUBE; t <= MR_THREADS; t++)
+        if (strcmp(nom, noms[t]) == 0)
+            return t;
+    return -1;
+}
+
+const char *mr_nom(enum mr_transport t) { return noms[t]; }
+
+/*
+ * Arbre binomial enraciné en 0 : l'ouvrier j reçoit les accumulateurs
+ * de j+1, j+2, j+4... tant que le pas est inférieur à son bit de poids
+ * faible (tous pour 0), puis envoie le sien à j privé de ce bit.
+ */
+static int parent(int j) { return j & (j - 1); }
+
+// tranche [debut, fin[ des éléments traités par l'ouvrier j
+static void tranche(size_t n, int c, int j, size_t *debut, size_t *fin) {
+    *debut = n * j / c;
+    *fin = n * (j + 1) / c;
+}
+
+static void lire_tout(int fd, void *buf, size_t t) {
+    ssize_t nlus;
+
+    for (size_t fait = 0; fait < t; fait += nlus) {
+        CHK(nlus = read(fd, (char *)buf + fait, t - fait));
+        if (nlus == 0)
+            raler(0, "mapreduce : ouvrier terminé prématurément");
+    }
+}
+
+static void attendre_ouvriers(int c) {
+    int raison;
+
+    for (int j = 0; j < c; j++) {
+        CHK(lance_attendre(&raison));
+        if (!(WIFEXITED(raison) && WEXITSTATUS(raison) == 0))
+            raler(0, "ouvrier mal terminé");
+    }
+}
+
+/*
+ * Transport par tubes : les lots de taille fixe (au plus PIPE_BUF
+ * octets, donc écrits et lus d'un bloc) sont pris dans le tube commun
+ * par le premier ouvrier libre. Comme dans la version historique, un
+ * processus de plus (rang 0, l'ancien additionneur) ne fait que
+ * réduire : il est la racine de l'arbre, les rangs 1 à c appliquent map.
+ */
+static size_t taille_lot(const struct mr_op *op) {
+    size_t max = PIPE_BUF / op->taille_elt;
+
+    if (op->taille_elt > PIPE_BUF || op->taille_acc > PIPE_BUF)
+        raler(0, "%s : éléments trop grands pour un tube", op->nom);
+    return (mr_lot > 0 && mr_lot < max ? mr_lot : max) * op->taille_elt;
+}
+
+static void ouvrier_tube(const struct mr_op *op, int j, int c, int entree,
+                         int (*red)[2], int sortie) {
+    alignas(max_align_t) char lot[PIPE_BUF], acc[PIPE_BUF], autre[PIPE_BUF];
+    size_t t = taille_lot(op);
+    ssize_t nlus;
+
+    op->neutre(acc);
+    if (j > 0) {
+        while ((nlus = read(entree, lot, t)) > 0)
+            op->map(acc, lot, nlus / op->taille_elt);
+        CHK(nlus);
+    }
+
+    for (int p = 1; p < c && (j & p) == 0; p <<= 1) {
+        if (j + p < c) {
+            lire_tout(red[j][0], autre, op->taille_acc);
+            op->reduire(acc, autre);
+        }
+    }
+    CHK(write(j == 0 ? sortie : red[parent(j)][1], acc, op->taille_acc));
+}
+
+static void mr_tube(const struct mr_op *op, int c, const char *elts, size_t n,
+                    void *res) {
+    int entree[2], sortie[2], (*red)[2];
+    size_t t = taille_lot(op), total = n * op->taille_elt;
+
+    CHK(pipe(entree));
+    CHK(pipe(sortie));
+    c++; // le réducteur
+    CHKN(red = malloc(c * sizeof *red));
+    for (int j = 0; j < c; j++)
+        CHK(pipe(red[j]));
+
+    for (int j = 0; j < c; j++) {
+        switch (lance_fork()) {
+        case -1:
+            raler(1, "cannot fork child %d", j);
+        case 0:
+            CHK(close(entree[1]));
+            CHK(close(sortie[0]));
+            ouvrier_tube(op, j, c, entree[0], red, sortie[1]);
+            exit(0);
+        default:
+            break;
+        }
+    }
+
+    CHK(close(entree[0]));
+    CHK(close(sortie[1]));
+    for (int j = 0; j < c; j++) {
+        CHK(close(red[j][0]));
+        CHK(close(red[j][1]));
+    }
+    free(red);
+
+    for (size_t o = 0; o < total; o += t)
+        CHK(write(entree[1], elts + o, total - o < t ? total - o : t));
+    CHK(close(entree[1]));
+
+    lire_tout(sortie[0], res, op->taille_acc);
+    CHK(close(sortie[0]));
+    attendre_ouvriers(c);
+}
+
+/*
+ * Transport par mémoire partagée : les éléments sont hérités du père
+ * (copie à l'écriture, jamais écrits), seuls les accumulateurs
+ * circulent, par coll_echanger.
+ */
+static void mr_shm(const struct mr_op *op, int c, const char *elts, size_t n,
+                   void *res) {
+    struct coll cc;
+    size_t debut, fin;
+    char *partage, *acc, *autre;
+
+    if (coll_init(&cc, c) == -1)
+        raler(1, "coll_init");
+    partage = mmap(NULL, op->taille_acc, PROT_READ | PROT_WRITE,
+                   MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (partage == MAP_FAILED)
+        raler(1, "mmap");
+
+    for (int j = 0; j < c; j++) {
+        switch (lance_fork()) {
+        case -1:
+            raler(1, "cannot fork child %d", j);
+        case 0:
+            coll_rejoindre(&cc, j);
+            CHKN(acc = malloc(op->taille_acc));
+            CHKN(autre = malloc(op->taille_acc));
+            tranche(n, c, j, &debut, &fin);
+            op->neutre(acc);
+            op->map(acc, elts + debut * op->taille_elt, fin - debut);
+            for (int p = 1; p < c && (j & p) == 0; p <<= 1) {
+                if (j + p < c) {
+                    coll_echanger(&cc, -1, NULL, 0, j + p, autre,
+                                  op->taille_acc);
+                    op->reduire(acc, autre);
+                }
+            }
+            if (j == 0)
+                memcpy(partage, acc, op->taille_acc);
+            else
+                coll_echanger(&cc, parent(j), acc, op->taille_acc, -1, NULL,
+                              0);
+            free(acc);
+            free(autre);
+            exit(0);
+        default:
+            break;
+        }
+    }
+
+    attendre_ouvriers(c);
+    memcpy(res, partage, op->taille_acc);
+    CHK(munmap(partage, op->taille_acc));
+    coll_detruire(&cc);
+}
+
+/*
+ * Transport par threads : au pas p, le thread j joint j+p et combine
+ * son accumulateur ; le thread 0 termine avec le résultat.
+ */
+struct tache {
+    pthread_t id;
+    int j, c;
+    size_t n;
+    const struct mr_op *op;
+    const char *elts;
+    struct tache *taches; // toutes les tâches, pour la réduction
+    char *acc;
+};
+
+static void *ouvrier_thread(void *arg) {
+    struct tache *t = arg;
+    const struct mr_op *op = t->op;
+    size_t debut, fin;
+
+    tranche(t->n, t->c, t->j, &debut, &fin);
+    op->neutre(t->acc);
+    op->map(t->acc, t->elts + debut * op->taille_elt, fin - debut);
+
+    for (int p = 1; p < t->c && (t->j & p) == 0; p <<= 1) {
+        if (t->j + p < t->c) {
+            struct tache *autre = &t->taches[t->j + p];
+            CHKT(pthread_join(autre->id, NULL));
+            op->reduire(t->acc, autre->acc);
+        }
+    }
+    return NULL;
+}
+
+static void mr_threads(const struct mr_op *op, int c, const char *elts,
+                       size_t n, void *res) {
+    struct tache *taches;
+
+    CHKN(taches = malloc(c * sizeof *taches));
+
+    // création dans l'ordre décroissant : quand le thread j tente de
+    // joindre j+p, l'identifiant de ce dernier est forcément connu
+    for (int j = c - 1; j >= 0; j--) {
+        taches[j].j = j;
+        taches[j].c = c;
+        taches[j].n = n;
+        taches[j].op = op;
+        taches[j].elts = elts;
+        taches[j].taches = taches;
+        CHKN(taches[j].acc = malloc(op->taille_acc));
+        CHKT(pthread_create(&taches[j].id, NULL, ouvrier_thread, &taches[j]));
+    }
+
+    // tous les autres threads sont joints par l'arbre de réduction
+    CHKT(pthread_join(taches[0].id, NULL));
+    memcpy(res, taches[0].acc, op->taille_acc);
+
+    for (int j = 0; j < c; j++)
+        free(taches[j].acc);
+    free(taches);
+}
+
+void mr_lancer(const struct mr_op *op, enum mr_transport t, int c,
+               const void *elts, size_t n, void *res) {
+    switch (t) {
+    case MR_TUBE:
+        mr_tube(op, c, elts, n, res);
+        break;
+    case MR_SHM:
+        mr_shm(op, c, elts, n, res);
+        break;
+    case MR_THREADS:
+        mr_threads(op, c, elts, n, res);
+        break;
+    }
+}
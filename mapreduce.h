@@ -0,0 +1,80 @@
+#ifndef MAPREDUCE_H
+#define MAPREDUCE_H
+
+#include <stddef.h>
+#include <stdnoreturn.h>
+
+/*
+ * Moteur map-reduce parallèle, généralisation de prodscal : c ouvriers
+ * appliquent "map" à leur part des éléments dans un accumulateur local,
+ * puis les accumulateurs sont combinés par "reduire" selon un arbre
+ * binomial (log2(c) étapes, au lieu d'un additionneur unique).
+ *
+ * Transports :
+ * - tube : les éléments sont injectés par lots dans un tube partagé
+ *   par les ouvriers (processus), chacun prenant le lot suivant dès
+ *   qu'il est libre ; la réduction passe par un tube par ouvrier ;
+ * - shm : chaque ouvrier (processus) traite une tranche contiguë des
+ *   éléments hérités du père, la réduction passe par les boîtes aux
+ *   lettres en mémoire partagée de collectif.c ;
+ * - threads : tranches contiguës, réduction par pthread_join.
+ *
+ * Un opérateur est défini par MR_OPERATEUR : la boucle de "map" est
+ * écrite pour le type exact des éléments et de l'accumulateur, sans
+ * appel de fonction par élément. reduire doit être associative et
+ * commutative (l'ordre de combinaison n'est pas déterminé).
+ */
+
+struct mr_op {
+    const char *nom;
+    size_t taille_elt; // taille d'un élément
+    size_t taille_acc; // taille de l'accumulateur (au plus PIPE_BUF)
+    void (*neutre)(void *acc);
+    void (*map)(void *acc, const void *elts, size_t n);
+    void (*reduire)(void *acc, const void *autre);
+};
+
+/*
+ * Définit l'opérateur nom sur des éléments de type TE et un
+ * accumulateur de type TA. Dans les instructions :
+ * - NEUTRE initialise *a ;
+ * - MAP accumule e[i] dans *a ;
+ * - REDUIRE combine *b dans *a.
+ */
+#define MR_OPERATEUR(nom, TE, TA, NEUTRE, MAP, REDUIRE)                        \
+    static void nom##_neutre(void *acc) {                                      \
+        TA *a = acc;                                                           \
+        NEUTRE;                                                                \
+    }                                                                          \
+    static void nom##_map(void *acc, const void *elts, size_t n) {             \
+        TA *a = acc;                                                           \
+        const TE *e = elts;                                                    \
+        for (size_t i = 0; i < n; i++) {                                       \
+            MAP;                                                               \
+        }                                                                      \
+    }                                                                          \
+    static void nom##_reduire(void *acc, const void *autre) {                  \
+        TA *a = acc;                                                           \
+        const TA *b = autre;                                                   \
+        REDUIRE;                                                               \
+    }                                                                          \
+    static const struct mr_op nom = {#nom,        sizeof(TE),   sizeof(TA),   \
+                                     nom##_neutre, nom##_map, nom##_reduire}
+
+enum mr_transport { MR_TUBE, MR_SHM, MR_THREADS };
+
+// éléments par lot du transport tube (0 : autant que PIPE_BUF le permet)
+extern size_t mr_lot;
+
+// -1 si le nom est inconnu
+int mr_choisir(const char *nom);
+const char *mr_nom(enum mr_transport t);
+
+// applique op aux n éléments avec c ouvriers, résultat dans res
+void mr_lancer(const struct mr_op *op, enum mr_transport t, int c,
+               const void *elts, size_t n, void *res);
+
+// fournie par le programme : affiche le message et termine le processus
+noreturn void raler(int syserr, const char *fmt, ...);
+
+#endif
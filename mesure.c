@@ -0,0 +1,223 @@
+#define _GNU_SOURCE // wait4
+
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/perf_event.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdnoreturn.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#define USAGE                                                                  \
+    "usage: mesure [-e etiquette] [-r repetitions] [-a avant] [-v] "          \
+    "commande ..."
+
+#define CHK(op)                                                                \
+    do {                                                                       \
+        if ((op) == -1)                                                        \
+            raler(1, #op);                                                     \
+    } while (0)
+
+noreturn void raler(int syserr, const char *fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    vfprintf(stderr, fmt, ap);
+    fprintf(stderr, "\n");
+    va_end(ap);
+    if (syserr)
+        perror("");
+    exit(1);
+}
+
+/*
+ * Exécute une commande et mesure, pour elle et tous ses descendants :
+ * - le temps écoulé (CLOCK_MONOTONIC) ;
+ * - la mémoire résidente maximale (ru_maxrss de wait4) ;
+ * - des compteurs perf_event_open hérités par les fils : cycles,
+ *   instructions, défauts de cache, changements de contexte.
+ * Le fils attend sur un tube que les compteurs soient ouverts, puis
+ * exécute la commande : enable_on_exec ne compte que la commande.
+ * Un compteur indisponible (machine virtuelle, perf_event_paranoid)
+ * est affiché "-". Avec -r, la meilleure des exécutions est retenue.
+ * -a donne une commande shell de préparation (effacer un résultat
+ * précédent...), exécutée avant chaque exécution et hors mesure.
+ * Sortie : une ligne séparée par tabulations, la sortie standard de la
+ * commande étant jetée (sauf -v).
+ */
+
+enum { CYCLES, INSTRUCTIONS, DEFAUTS_CACHE, CHANGEMENTS, NB_COMPTEURS };
+
+const struct {
+    uint32_t type;
+    uint64_t config;
+} compteurs[NB_COMPTEURS] = {
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+    {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES},
+};
+
+struct resultat {
+    double mur_ms;
+    long rss_kio;
+    int64_t val[NB_COMPTEURS]; // -1 : indisponible
+};
+
+int ouvrir_compteur(int i, pid_t pid) {
+    struct perf_event_attr attr;
+    int fd;
+
+    memset(&attr, 0, sizeof attr);
+    attr.size = sizeof attr;
+    attr.type = compteurs[i].type;
+    attr.config = compteurs[i].config;
+    attr.disabled = 1;
+    attr.enable_on_exec = 1;
+    attr.inherit = 1;
+    attr.read_format =
+        PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    fd = syscall(SYS_perf_event_open, &attr, pid, -1, -1, PERF_FLAG_FD_CLOEXEC);
+    if (fd == -1 && (errno == EACCES || errno == EPERM)) {
+        // perf_event_paranoid : se limiter à l'espace utilisateur
+        attr.exclude_kernel = attr.exclude_hv = 1;
+        fd = syscall(SYS_perf_event_open, &attr, pid, -1, -1,
+                     PERF_FLAG_FD_CLOEXEC);
+    }
+    return fd;
+}
+
+// valeur extrapolée si le compteur a été multiplexé
+int64_t lire_compteur(int fd) {
+    uint64_t v[3]; // valeur, temps activé, temps compté
+
+    if (fd == -1 || read(fd, v, sizeof v) != sizeof v || v[2] == 0)
+        return -1;
+    return v[2] < v[1] ? (int64_t)((double)v[0] * v[1] / v[2]) : (int64_t)v[0];
+}
+
+double maintenant_ms(void) {
+    struct timespec ts;
+    CHK(clock_gettime(CLOCK_MONOTONIC, &ts));
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+void executer(char *argv[], int verbeux, struct resultat *res) {
+    int tube[2], fd[NB_COMPTEURS], raison, nul;
+    struct rusage ru;
+    double debut;
+    char c;
+    pid_t pid;
+
+    CHK(pipe2(tube, O_CLOEXEC));
+    switch (pid = fork()) {
+    case -1:
+        raler(1, "fork");
+    case 0:
+        CHK(close(tube[1]));
+        if (!verbeux) {
+            CHK(nul = open("/dev/null", O_WRONLY));
+            CHK(dup2(nul, 1));
+            CHK(close(nul));
+        }
+        // attendre que les compteurs soient en place
+        CHK(read(tube[0], &c, 1));
+        execvp(argv[0], argv);
+        raler(1, "exec %s", argv[0]);
+    default:
+        break;
+    }
+
+    CHK(close(tube[0]));
+    for (int i = 0; i < NB_COMPTEURS; i++)
+        fd[i] = ouvrir_compteur(i, pid);
+
+    debut = maintenant_ms();
+    CHK(write(tube[1], "", 1));
+    CHK(close(tube[1]));
+    CHK(wait4(pid, &raison, 0, &ru));
+    res->mur_ms = maintenant_ms() - debut;
+
+    if (!(WIFEXITED(raison) && WEXITSTATUS(raison) == 0))
+        raler(0, "%s : commande mal terminée", argv[0]);
+
+    res->rss_kio = ru.ru_maxrss;
+    for (int i = 0; i < NB_COMPTEURS; i++) {
+        res->val[i] = lire_compteur(fd[i]);
+        if (fd[i] != -1)
+            CHK(close(fd[i]));
+    }
+}
+
+void preparer(const char *avant) {
+    int raison;
+
+    CHK(raison = system(avant));
+    if (!(WIFEXITED(raison) && WEXITSTATUS(raison) == 0))
+        raler(0, "%s : préparation mal terminée", avant);
+}
+
+void afficher_val(int64_t v) {
+    if (v < 0)
+        printf("\t-");
+    else
+        printf("\t%lld", (long long)v);
+}
+
+int main(int argc, char *argv[]) {
+    const char *etiquette = NULL, *avant = NULL;
+    struct resultat meilleur, res;
+    int opt, rep = 1, verbeux = 0;
+
+    while ((opt = getopt(argc, argv, "+e:r:a:v")) != -1) {
+        switch (opt) {
+        case 'a':
+            avant = optarg;
+            break;
+        case 'e':
+            etiquette = optarg;
+            break;
+        case 'r':
+            rep = atoi(optarg);
+            break;
+        case 'v':
+            verbeux = 1;
+            break;
+        default:
+            raler(0, USAGE);
+        }
+    }
+    if (optind == argc || rep <= 0)
+        raler(0, USAGE);
+    argv += optind;
+
+    for (int i = 0; i < rep; i++) {
+        if (avant != NULL)
+            preparer(avant);
+        executer(argv, verbeux, &res);
+        if (i == 0 || res.mur_ms < meilleur.mur_ms)
+            meilleur = res;
+    }
+
+    printf("%s\t%.2f\t%ld", etiquette != NULL ? etiquette : argv[0],
+           meilleur.mur_ms, meilleur.rss_kio);
+    for (int i = 0; i < NB_COMPTEURS; i++)
+        afficher_val(meilleur.val[i]);
+    if (meilleur.val[CYCLES] > 0 && meilleur.val[INSTRUCTIONS] >= 0)
+        printf("\t%.2f\n",
+               (double)meilleur.val[INSTRUCTIONS] / meilleur.val[CYCLES]);
+    else
+        printf("\t-\n");
+    CHK(fflush(stdout) == EOF ? -1 : 0);
+
+    exit(0);
+}
@@ -0,0 +1,305 @@
+#define _GNU_SOURCE // O_DIRECTORY, O_NOFOLLOW, O_CLOEXEC
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "parcours.h"
+
+#define PARC_INCONNU -1 // d_type non fourni par le système de fichiers
+
+// les fonctions pthread_* renvoient le code d'erreur au lieu de -1
+#define CHKT(op)                                                               \
+    do {                                                                       \
+        if ((errno = (op)) != 0)                                               \
+            raler(1, #op);                                                     \
+    } while (0)
+
+// sous-répertoire trouvé : récursion (profondeur) ou mise en file
+typedef void (*descendre_t)(const struct parcours *p,
+                            const struct parc_entree *e, char *chemin,
+                            size_t lg, void *ctx);
+
+/*
+ * Mode file (largeur ou threads) : les répertoires en attente, chacun
+ * avec son chemin complet. Le parcours est fini quand la file est vide
+ * et qu'aucun thread n'est en train de lire un répertoire.
+ */
+struct tache {
+    struct tache *suiv;
+    int profondeur;
+    char chemin[];
+};
+
+struct file {
+    pthread_mutex_t m;
+    pthread_cond_t c;
+    struct tache *tete, *queue;
+    int actifs;
+    const struct parcours *p;
+};
+
+void parc_init(struct parcours *p, size_t chemin_max) {
+    p->ordre = PARC_PROFONDEUR;
+    p->nthreads = 1;
+    p->stat = 0;
+    p->chemin_max = chemin_max;
+    p->avant_rep = p->entree = p->apres_rep = NULL;
+    p->arg = NULL;
+}
+
+static int type_dirent(unsigned char d_type) {
+    switch (d_type) {
+    case DT_DIR:
+        return PARC_REP;
+    case DT_REG:
+        return PARC_FICHIER;
+    case DT_LNK:
+        return PARC_LIEN;
+    case DT_UNKNOWN:
+        return PARC_INCONNU;
+    default:
+        return PARC_AUTRE;
+    }
+}
+
+static enum parc_type type_mode(mode_t mode) {
+    switch (mode & S_IFMT) {
+    case S_IFDIR:
+        return PARC_REP;
+    case S_IFREG:
+        return PARC_FICHIER;
+    case S_IFLNK:
+        return PARC_LIEN;
+    default:
+        return PARC_AUTRE;
+    }
+}
+
+// ajoute "/nom" au chemin de longueur lg, renvoie la nouvelle longueur
+static size_t allonger(const struct parcours *p, char *chemin, size_t lg,
+                       const char *nom) {
+    size_t ln = strlen(nom);
+
+    if (lg + 1 + ln > p->chemin_max)
+        raler(0, "chemin %s/%s trop long", chemin, nom);
+    chemin[lg] = '/';
+    memcpy(chemin + lg + 1, nom, ln + 1);
+    return lg + 1 + ln;
+}
+
+/*
+ * Visite d'un répertoire déjà ouvert (rep->fd) : avant_rep, chaque
+ * entrée, puis apres_rep une fois le répertoire fermé.
+ */
+static void visiter(const struct parcours *p, struct parc_entree *rep,
+                    char *chemin, size_t lg, descendre_t descendre,
+                    void *ctx) {
+    struct parc_entree e;
+    struct dirent *d;
+    struct stat st;
+    size_t lg2;
+    DIR *dp;
+    int t;
+
+    if (p->avant_rep != NULL)
+        p->avant_rep(rep, p->arg);
+
+    if ((dp = fdopendir(rep->fd)) == NULL)
+        raler(1, "%s", chemin);
+
+    errno = 0;
+    while ((d = readdir(dp)) != NULL) {
+        if (strcmp(d->d_name, ".") == 0 || strcmp(d->d_name, "..") == 0) {
+            errno = 0;
+            continue;
+        }
+        lg2 = allonger(p, chemin, lg, d->d_name);
+
+        e.chemin = chemin;
+        e.nom = d->d_name;
+        e.dirfd = dirfd(dp);
+        e.fd = -1;
+        e.st = NULL;
+        e.profondeur = rep->profondeur + 1;
+
+        t = type_dirent(d->d_type);
+        if (t == PARC_INCONNU || (p->stat && t != PARC_REP)) {
+            if (fstatat(e.dirfd, e.nom, &st, AT_SYMLINK_NOFOLLOW) == -1)
+                raler(1, "%s", chemin);
+            t = type_mode(st.st_mode);
+            e.st = &st;
+        }
+        e.type = t;
+
+        if (e.type == PARC_REP)
+            descendre(p, &e, chemin, lg2, ctx);
+        else if (p->entree != NULL)
+            p->entree(&e, p->arg);
+
+        chemin[lg] = '\0';
+        errno = 0;
+    }
+    if (errno != 0)
+        raler(1, "readdir %s", chemin);
+    if (closedir(dp) == -1)
+        raler(1, "closedir %s", chemin);
+
+    rep->fd = -1;
+    if (p->apres_rep != NULL)
+        p->apres_rep(rep, p->arg);
+}
+
+// ouvre le répertoire e et complète e->fd, e->st
+static void ouvrir(struct parc_entree *e, const char *chemin, int suivre,
+                   struct stat *st) {
+    int flags = O_RDONLY | O_DIRECTORY | O_CLOEXEC | (suivre ? 0 : O_NOFOLLOW);
+
+    if ((e->fd = openat(e->dirfd, e->nom, flags)) == -1)
+        raler(1, "%s", chemin);
+    if (fstat(e->fd, st) == -1)
+        raler(1, "fstat %s", chemin);
+    e->st = st;
+    e->type = PARC_REP;
+}
+
+static void descendre_profondeur(const struct parcours *p,
+                                 const struct parc_entree *e, char *chemin,
+                                 size_t lg, void *ctx) {
+    struct parc_entree rep = *e;
+    struct stat st;
+
+    ouvrir(&rep, chemin, 0, &st);
+    visiter(p, &rep, chemin, lg, descendre_profondeur, ctx);
+}
+
+static void mettre_en_file(const struct parcours *p,
+                           const struct parc_entree *e, char *chemin,
+                           size_t lg, void *ctx) {
+    struct file *f = ctx;
+    struct tache *t;
+
+    (void)p;
+    if ((t = malloc(sizeof *t + lg + 1)) == NULL)
+        raler(1, "malloc");
+    memcpy(t->chemin, chemin, lg + 1);
+    t->profondeur = e->profondeur;
+    t->suiv = NULL;
+
+    CHKT(pthread_mutex_lock(&f->m));
+    if (f->queue == NULL)
+        f->tete = t;
+    else
+        f->queue->suiv = t;
+    f->queue = t;
+    CHKT(pthread_cond_signal(&f->c));
+    CHKT(pthread_mutex_unlock(&f->m));
+}
+
+static void traiter(struct file *f, struct tache *t) {
+    const struct parcours *p = f->p;
+    char chemin[p->chemin_max + 1];
+    struct parc_entree rep;
+    const char *nom;
+    struct stat st;
+
+    strcpy(chemin, t->chemin);
+    // rouvert par son chemin : son parent est peut-être déjà fermé
+    nom = strrchr(chemin, '/');
+    rep.chemin = chemin;
+    rep.nom = t->profondeur == 0 || nom == NULL ? chemin : nom + 1;
+    rep.dirfd = AT_FDCWD;
+    rep.profondeur = t->profondeur;
+    rep.fd = -1;
+    if ((rep.fd = open(chemin, O_RDONLY | O_DIRECTORY | O_CLOEXEC |
+                                   (t->profondeur == 0 ? 0 : O_NOFOLLOW))) ==
+        -1)
+        raler(1, "%s", chemin);
+    if (fstat(rep.fd, &st) == -1)
+        raler(1, "fstat %s", chemin);
+    rep.st = &st;
+    rep.type = PARC_REP;
+
+    visiter(p, &rep, chemin, strlen(chemin), mettre_en_file, f);
+}
+
+static void *travailleur(void *arg) {
+    struct file *f = arg;
+    struct tache *t;
+
+    for (;;) {
+        CHKT(pthread_mutex_lock(&f->m));
+        while (f->tete == NULL && f->actifs > 0)
+            CHKT(pthread_cond_wait(&f->c, &f->m));
+        if (f->tete == NULL) {
+            // plus rien en file ni en cours : tout le monde s'arrête
+            CHKT(pthread_cond_broadcast(&f->c));
+            CHKT(pthread_mutex_unlock(&f->m));
+            return NULL;
+        }
+        t = f->tete;
+        if ((f->tete = t->suiv) == NULL)
+            f->queue = NULL;
+        f->actifs++;
+        CHKT(pthread_mutex_unlock(&f->m));
+
+        traiter(f, t);
+        free(t);
+
+        CHKT(pthread_mutex_lock(&f->m));
+        if (--f->actifs == 0 && f->tete == NULL)
+            CHKT(pthread_cond_broadcast(&f->c));
+        CHKT(pthread_mutex_unlock(&f->m));
+    }
+}
+
+static void parcourir_file(const struct parcours *p, const char *racine) {
+    struct parc_entree e = {.profondeur = 0};
+    struct file f = {.tete = NULL, .queue = NULL, .actifs = 0, .p = p};
+    int n = p->nthreads > 1 ? p->nthreads - 1 : 0;
+    pthread_t th[n > 0 ? n : 1];
+    char chemin[p->chemin_max + 1];
+
+    CHKT(pthread_mutex_init(&f.m, NULL));
+    CHKT(pthread_cond_init(&f.c, NULL));
+
+    strcpy(chemin, racine);
+    mettre_en_file(p, &e, chemin, strlen(chemin), &f);
+
+    for (int i = 0; i < n; i++)
+        CHKT(pthread_create(&th[i], NULL, travailleur, &f));
+    travailleur(&f);
+    for (int i = 0; i < n; i++)
+        CHKT(pthread_join(th[i], NULL));
+
+    CHKT(pthread_cond_destroy(&f.c));
+    CHKT(pthread_mutex_destroy(&f.m));
+}
+
+void parc_lancer(const struct parcours *p, const char *racine) {
+    char chemin[p->chemin_max + 1];
+    struct parc_entree rep;
+    struct stat st;
+
+    if (strlen(racine) > p->chemin_max)
+        raler(0, "chemin %s trop long", racine);
+
+    if (p->ordre == PARC_LARGEUR || p->nthreads > 1) {
+        parcourir_file(p, racine);
+        return;
+    }
+
+    strcpy(chemin, racine);
+    rep.chemin = chemin;
+    rep.nom = chemin;
+    rep.dirfd = AT_FDCWD;
+    rep.profondeur = 0;
+    ouvrir(&rep, chemin, 1, &st); // la racine peut être un lien
+    visiter(p, &rep, chemin, strlen(chemin), descendre_profondeur, NULL);
+}
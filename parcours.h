@@ -0,0 +1,61 @@
+#ifndef PARCOURS_H
+#define PARCOURS_H
+
+#include <stddef.h>
+#include <stdnoreturn.h>
+#include <sys/stat.h>
+
+/*
+ * Parcours d'arborescence commun à infos et majus.
+ *
+ * Le programme fournit des fonctions appelées pour chaque répertoire
+ * (avant et après ses entrées) et pour chaque autre entrée (fichier,
+ * lien symbolique...). Les liens symboliques ne sont jamais suivis.
+ *
+ * - les entrées sont ouvertes relativement au descripteur de leur
+ *   répertoire (dirfd, nom), sans reconstruire le chemin complet ;
+ * - le type vient de d_type quand le système le fournit : pas de lstat
+ *   par entrée, sauf si le programme demande stat ;
+ * - ordres : en profondeur (récursif, le répertoire est terminé après
+ *   ses sous-répertoires) ou en largeur (file de répertoires, terminé
+ *   après ses propres entrées) ;
+ * - avec nthreads > 1, la file est traitée par autant de threads : les
+ *   fonctions du programme doivent alors être sûres vis-à-vis des
+ *   threads, et l'ordre de visite n'est plus déterminé.
+ * Toute erreur (y compris un chemin de plus de chemin_max octets)
+ * termine le programme par raler().
+ */
+
+enum parc_type { PARC_REP, PARC_FICHIER, PARC_LIEN, PARC_AUTRE };
+
+enum parc_ordre { PARC_PROFONDEUR, PARC_LARGEUR };
+
+struct parc_entree {
+    const char *chemin;    // chemin complet, racine comprise
+    const char *nom;       // dernier composant (chemin pour la racine)
+    int dirfd;             // répertoire contenant l'entrée (AT_FDCWD racine)
+    int fd;                // répertoire lui-même ouvert (PARC_REP), sinon -1
+    enum parc_type type;
+    const struct stat *st; // toujours pour PARC_REP, sinon si stat demandé
+    int profondeur;        // 0 pour la racine
+};
+
+struct parcours {
+    enum parc_ordre ordre;
+    int nthreads;      // 1 : dans le thread appelant
+    int stat;          // fournir st pour toutes les entrées
+    size_t chemin_max; // longueur maximale d'un chemin
+    void (*avant_rep)(const struct parc_entree *e, void *arg);
+    void (*entree)(const struct parc_entree *e, void *arg);
+    void (*apres_rep)(const struct parc_entree *e, void *arg);
+    void *arg;
+};
+
+// valeurs par défaut : profondeur, 1 thread, pas de stat
+void parc_init(struct parcours *p, size_t chemin_max);
+void parc_lancer(const struct parcours *p, const char *racine);
+
+// fournie par le programme : affiche le message et termine le processus
+noreturn void raler(int syserr, const char *fmt, ...);
+
+#endif
@@ -1,19 +1,49 @@
+#define _GNU_SOURCE // ppoll
+
 #include <dirent.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <limits.h>
+#include <linux/futex.h>
+#include <poll.h>
 #include <signal.h>
 #include <stdarg.h>
+#include <stdatomic.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdnoreturn.h>
 #include <string.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/prctl.h>
 #include <sys/stat.h>
+#include <sys/syscall.h>
 #include <sys/types.h>
 #include <sys/wait.h>
+#include <time.h>
 #include <unistd.h>
 
+#include "lancement.h"
+
 #define CHEMIN_MAX 128
+#define LOT_MAX 4096 // -b : valeurs de x par tour, au plus (cf USAGE)
+
+#define USAGE                                                                  \
+    "usage : poly [-H] [-m] [-n signal|eventfd|futex] [-s spin] [-p prof] "    \
+    "[-d] [-b lot] [-t] k f a0 ... an\n"                                       \
+    "       -b lot : 1 <= lot <= 4096 ; en cas de dépassement de capacité, "   \
+    "aucune valeur\n"                                                          \
+    "                du lot fautif n'est affichée"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define PAUSE() __builtin_ia32_pause()
+#else
+#define PAUSE() ((void)0)
+#endif
+
+#define FIN_EVENTFD (UINT64_C(1) << 32) // valeur de terminaison (eventfd)
+#define DELAI_PERE_NS 10000000          // le père vérifie SIGUSR2 (10 ms)
 
 volatile sig_atomic_t s1_recu = 0;
 volatile sig_atomic_t s2_recu = 0;
@@ -24,10 +54,16 @@ volatile sig_atomic_t s2_recu = 0;
             raler(1, #op);                                                     \
     } while (0)
 
+#define CHKN(op)                                                               \
+    do {                                                                       \
+        if ((op) == NULL)                                                      \
+            raler(1, #op);                                                     \
+    } while (0)
+
 #define CHKS(op)                                                               \
     do {                                                                       \
         if ((op) == -1) {                                                      \
-            CHK(kill(getppid(), SIGUSR2));                                     \
+            CHK(prevenir_pere());                                              \
             raler(1, #op);                                                     \
         }                                                                      \
     } while (0)
@@ -43,10 +79,82 @@ noreturn void raler(int syserr, const char *fmt, ...) {
     exit(1);
 }
 
+/*
+ * Un fils en erreur prévient le père (SIGUSR2), dont la terminaison tue
+ * le reste de l'anneau (PR_SET_PDEATHSIG) : lui-même doit survivre le
+ * temps d'afficher son message.
+ */
+int prevenir_pere(void) {
+    if (prctl(PR_SET_PDEATHSIG, 0) == -1)
+        return -1;
+    return kill(getppid(), SIGUSR2);
+}
+
 struct Data {
     int n, i, x, p;
 };
 
+/*
+ * Mode mémoire partagée (-m) : l'état et la table des pid, habituellement
+ * rangés dans le fichier f, sont placés dans une projection anonyme
+ * partagée créée avant les fork. Un saut dans l'anneau ne coûte plus
+ * lseek + read + write mais quelques accès mémoire. La publication est
+ * ordonnée par des barrières release (avant le signal) et acquire (après
+ * réception).
+ */
+struct partage {
+    struct Data data;
+    atomic_int fin; // demande de terminaison (futex)
+    int64_t jeton;  // valeur en transit dans l'anneau (-d)
+    pid_t pid[];    // c1 ... cn puis le père, comme dans le fichier
+};
+
+struct partage *shm = NULL; // NULL : mode fichier
+
+/*
+ * Mécanismes de notification entre positions de l'anneau : 0 à n pour
+ * les fils, n+1 pour le père.
+ * - signal : SIGUSR1 puis sigsuspend (comportement d'origine) ;
+ * - eventfd : un eventfd par position, créé avant les fork ;
+ * - futex : un mot par position dans la projection partagée (impose -m),
+ *   avec éventuellement une attente active bornée avant de dormir. Le
+ *   réveil n'est fait que si le destinataire est effectivement bloqué.
+ */
+enum notif { NOTIF_SIGNAL, NOTIF_EVENTFD, NOTIF_FUTEX };
+
+struct reveil {
+    _Alignas(64) atomic_uint seq; // incrémenté à chaque notification
+    atomic_uint dort;             // destinataire bloqué dans FUTEX_WAIT
+};
+
+/*
+ * Mode pipeline (-p prof) : jusqu'à prof valeurs de x circulent en même
+ * temps dans l'anneau, si bien que tous les fils peuvent travailler à la
+ * fois. La valeur x occupe le créneau (x-1) % prof, qui porte son
+ * accumulateur de Horner et l'étape suivante (position du fils qui doit
+ * la traiter, n+1 pour le père). Chaque fils traite les x dans l'ordre
+ * et le père les récupère dans l'ordre : l'affichage reste trié.
+ * Ce mode implique -H et -m, et l'attente se fait par futex sur l'étape.
+ */
+struct creneau {
+    _Alignas(64) atomic_uint etape;
+    atomic_uint attente; // nb de processus bloqués sur etape
+    int x, p;
+};
+
+enum notif notif = NOTIF_SIGNAL;
+int spin = 0;              // nb max d'itérations d'attente active
+pid_t first_pid;           // pid de c0 (connu du père uniquement)
+int *efd = NULL;           // eventfd de chaque position
+struct reveil *rev = NULL; // mot futex de chaque position
+int prof = 0;                  // nb de x en vol (0 : pas de pipeline)
+struct creneau *cren = NULL;   // créneaux du pipeline
+int64_t *diff = NULL;          // table des différences initiale (-d)
+int lot = 0;                   // nb de x par tour (0 : un seul, sans -b)
+int largeur = 0;               // lot arrondi à un multiple de VOIES
+int64_t *lot_x = NULL;         // x du lot courant (projection partagée)
+int64_t *lot_p = NULL;         // accumulateurs de Horner du lot
+
 void recv_sigusr1(int sig) {
     (void)sig;
     s1_recu = 1;
@@ -65,6 +173,12 @@ void calculate_aixi(struct Data *data, int ai) {
     char str_ai[50];
     char str_x[50];
 
+    // "expr ai" puis 2 arguments par puissance de x, et NULL à la fin
+    if (2 * data->i + 2 > CHEMIN_MAX) {
+        CHKS(prevenir_pere());
+        raler(0, "degré %d trop grand pour expr (utiliser -H)", data->i);
+    }
+
     sprintf(str_ai, "%d", ai);
     sprintf(str_x, "%d", data->x);
 
@@ -76,40 +190,52 @@ void calculate_aixi(struct Data *data, int ai) {
     }
     args[arg_count] = NULL; // last argument
 
-    CHK(pipe(tube));
-
-    switch (fork()) {
-    case -1:
-        raler(1, "fork");
-    case 0:
-        // child process
-        CHK(close(tube[0]));
-        CHK(dup2(tube[1], 1));
-
-        execvp(args[0], args);
-        raler(1, "exec %s", args[0]);
+    // O_CLOEXEC : seule l'extrémité en écriture, en sortie 1, passe à expr
+    CHKS(pipe2(tube, O_CLOEXEC));
+    CHKS(lance_exec(args, -1, tube[1]));
+    CHKS(close(tube[1]));
 
-    default:
-        // parent process
-        CHKS(wait(&raison));
-        if (!(WIFEXITED(raison) && WEXITSTATUS(raison) == 0)) {
-            CHKS(kill(getppid(), SIGUSR2));
-            exit(1);
-        }
+    CHKS(lance_attendre(&raison));
+    if (!(WIFEXITED(raison) && WEXITSTATUS(raison) == 0)) {
+        CHKS(prevenir_pere());
+        exit(1);
+    }
 
-        CHKS(close(tube[1]));
-        CHKS(read(tube[0], result_str, sizeof(result_str)));
-        CHKS(close(tube[0]));
+    CHKS(read(tube[0], result_str, sizeof(result_str)));
+    CHKS(close(tube[0]));
 
-        result = atoi(result_str);
-        data->p += result;
-        data->i++;
+    result = atoi(result_str);
+    data->p += result;
+    data->i++;
+}
 
-        break;
+/*
+ * Évaluation native par le schéma de Horner : le fils placé en position i
+ * dans l'anneau détient le coefficient a(n-i) et calcule p = p * x + a(n-i).
+ * Aucun processus n'est créé, et les débordements sont détectés au lieu
+ * d'être tronqués silencieusement. Le pas est calculé sur 64 bits (p, x
+ * et a tiennent sur un int) : seule la valeur transmise doit tenir sur
+ * un int, pas le produit intermédiaire p * x.
+ */
+void horner_aixi(struct Data *data, int ai) {
+    int64_t p = (int64_t)data->p * data->x + ai;
+
+    if (p > INT_MAX || p < INT_MIN) {
+        CHKS(prevenir_pere());
+        raler(0, "dépassement de capacité pour x = %d", data->x);
     }
+
+    data->p = p;
+    data->i++;
 }
 
 void read_data(int fd, struct Data *data, int parent) {
+    if (shm != NULL) {
+        atomic_thread_fence(memory_order_acquire);
+        *data = shm->data;
+        return;
+    }
+
     lseek(fd, 0, SEEK_SET);
     if (parent)
         CHK(read(fd, data, sizeof(struct Data)));
@@ -118,6 +244,12 @@ void read_data(int fd, struct Data *data, int parent) {
 }
 
 void write_data(int fd, struct Data *data, int parent) {
+    if (shm != NULL) {
+        shm->data = *data;
+        atomic_thread_fence(memory_order_release);
+        return;
+    }
+
     lseek(fd, 0, SEEK_SET);
     if (parent)
         CHK(write(fd, data, sizeof(struct Data)));
@@ -125,53 +257,533 @@ void write_data(int fd, struct Data *data, int parent) {
         CHKS(write(fd, data, sizeof(struct Data)));
 }
 
-void child(int fd, int ai) {
-    struct Data data;
+// pid d'indice j dans la table (0 pour c1, ..., n pour le père)
+pid_t read_pid(int fd, int j, int parent) {
     pid_t pid;
-    sigset_t empty;
 
-    CHKS(sigemptyset(&empty));
+    if (shm != NULL)
+        return shm->pid[j];
+
+    lseek(fd, sizeof(struct Data) + j * sizeof(pid_t), SEEK_SET);
+    if (parent)
+        CHK(read(fd, &pid, sizeof(pid)));
+    else
+        CHKS(read(fd, &pid, sizeof(pid)));
+    return pid;
+}
+
+// taille de l'état et de la table des pid, arrondie à une ligne de cache
+size_t taille_entete(int n) {
+    return (sizeof *shm + (n + 1) * sizeof(pid_t) + 63) / 64 * 64;
+}
+
+// taille de la projection : en-tête, puis mots futex et créneaux alignés
+size_t taille_partage(int n) {
+    size_t t = taille_entete(n);
+
+    if (notif == NOTIF_FUTEX)
+        t += (n + 2) * sizeof(struct reveil);
+    t += prof * sizeof(struct creneau);
+    t += 2 * largeur * sizeof(int64_t);
+    return t;
+}
+
+long futex(atomic_uint *mot, int op, unsigned val, struct timespec *delai,
+           unsigned masque) {
+    return syscall(SYS_futex, mot, op, val, delai, NULL, masque);
+}
+
+// réveille la position j de l'anneau (n+1 pour le père)
+void notifier(int fd, int j, int parent) {
+    uint64_t un = 1;
+    pid_t pid;
+
+    switch (notif) {
+    case NOTIF_SIGNAL:
+        pid = j == 0 ? first_pid : read_pid(fd, j - 1, parent);
+        if (parent)
+            CHK(kill(pid, SIGUSR1));
+        else
+            CHKS(kill(pid, SIGUSR1));
+        break;
+
+    case NOTIF_EVENTFD:
+        if (parent)
+            CHK(write(efd[j], &un, sizeof un));
+        else
+            CHKS(write(efd[j], &un, sizeof un));
+        break;
+
+    case NOTIF_FUTEX:
+        // seq_cst : l'incrément et la lecture de "dort" ne peuvent pas
+        // être réordonnés, symétriquement à attendre()
+        atomic_fetch_add(&rev[j].seq, 1);
+        if (atomic_load(&rev[j].dort))
+            futex(&rev[j].seq, FUTEX_WAKE, 1, NULL, 0);
+        break;
+    }
+}
 
-    while (!s2_recu) {
-        sigsuspend(&empty);
+// le père vérifie si un fils a signalé une erreur (SIGUSR2 masqué)
+void verifier_sigusr2(void) {
+    sigset_t pending;
 
+    CHK(sigpending(&pending));
+    if (sigismember(&pending, SIGUSR2))
+        raler(0, "fils mal terminé");
+}
+
+/*
+ * Attend une notification pour la position moi. Renvoie 1 si le jeton
+ * est arrivé, 0 si le père demande la terminaison (fils uniquement).
+ * Pour le père, une erreur signalée par un fils (SIGUSR2) est fatale.
+ */
+int attendre(int moi, int parent) {
+    static unsigned vu = 0; // dernière valeur de seq consommée (futex)
+    sigset_t empty;
+    struct pollfd pfd;
+    struct timespec delai = {0, DELAI_PERE_NS};
+    uint64_t val;
+    int t;
+
+    switch (notif) {
+    case NOTIF_SIGNAL:
+        if (parent)
+            CHK(sigemptyset(&empty));
+        else
+            CHKS(sigemptyset(&empty));
+        while (!s1_recu && !s2_recu)
+            sigsuspend(&empty);
+        if (parent && s2_recu)
+            raler(0, "fils mal terminé\n");
         if (s1_recu) {
             s1_recu = 0;
+            return 1;
+        }
+        s2_recu = 0;
+        return 0;
+
+    case NOTIF_EVENTFD:
+        if (parent) {
+            // ppoll démasque SIGUSR2 de façon atomique, comme sigsuspend
+            CHK(sigemptyset(&empty));
+            pfd.fd = efd[moi];
+            pfd.events = POLLIN;
+            while (ppoll(&pfd, 1, NULL, &empty) == -1) {
+                if (errno != EINTR)
+                    raler(1, "ppoll");
+                if (s2_recu)
+                    raler(0, "fils mal terminé");
+            }
+            CHK(read(efd[moi], &val, sizeof val));
+        } else {
+            CHKS(read(efd[moi], &val, sizeof val));
+        }
+        return val < FIN_EVENTFD;
+
+    case NOTIF_FUTEX:
+        for (t = 0; t < spin && atomic_load(&rev[moi].seq) == vu; t++)
+            PAUSE();
+        while (atomic_load(&rev[moi].seq) == vu) {
+            atomic_store(&rev[moi].dort, 1);
+            if (futex(&rev[moi].seq, FUTEX_WAIT, vu, parent ? &delai : NULL,
+                      0) == -1 &&
+                errno != EAGAIN && errno != EINTR && errno != ETIMEDOUT) {
+                if (parent)
+                    raler(1, "futex");
+                CHKS(-1);
+            }
+            atomic_store(&rev[moi].dort, 0);
+            if (parent)
+                verifier_sigusr2();
+        }
+        vu = atomic_load(&rev[moi].seq);
+        return parent || !atomic_load(&shm->fin);
+    }
+    return 0;
+}
 
-            read_data(fd, &data, 0);
+// demande la terminaison des n+1 fils
+void terminer(int fd, int n) {
+    switch (notif) {
+    case NOTIF_SIGNAL:
+        CHK(kill(first_pid, SIGUSR2));
+        for (int j = 0; j < n; ++j)
+            CHK(kill(read_pid(fd, j, 1), SIGUSR2));
+        break;
 
-            calculate_aixi(&data, ai);
+    case NOTIF_EVENTFD:
+        for (int j = 0; j <= n; ++j) {
+            uint64_t fin = FIN_EVENTFD;
+            CHK(write(efd[j], &fin, sizeof fin));
+        }
+        break;
+
+    case NOTIF_FUTEX:
+        atomic_store(&shm->fin, 1);
+        for (int j = 0; j <= n; ++j)
+            notifier(fd, j, 1);
+        break;
+    }
+}
+
+/*
+ * Attend que le créneau atteigne l'étape indiquée. Plusieurs processus
+ * peuvent attendre le même créneau à des étapes différentes : chacun
+ * s'endort avec le bit (etape % 32) pour que publier_etape() ne réveille
+ * que le destinataire et pas tout l'anneau.
+ */
+void attendre_etape(struct creneau *c, unsigned etape, int parent) {
+    struct timespec echeance;
+    unsigned e;
+    int t;
+
+    for (t = 0; t < spin && atomic_load(&c->etape) != etape; t++)
+        PAUSE();
+    while ((e = atomic_load(&c->etape)) != etape) {
+        if (parent) {
+            // FUTEX_WAIT_BITSET attend une échéance absolue
+            CHK(clock_gettime(CLOCK_MONOTONIC, &echeance));
+            echeance.tv_nsec += DELAI_PERE_NS;
+            if (echeance.tv_nsec >= 1000000000) {
+                echeance.tv_sec++;
+                echeance.tv_nsec -= 1000000000;
+            }
+        }
+        atomic_fetch_add(&c->attente, 1);
+        if (futex(&c->etape, FUTEX_WAIT_BITSET, e, parent ? &echeance : NULL,
+                  1u << (etape % 32)) == -1 &&
+            errno != EAGAIN && errno != EINTR && errno != ETIMEDOUT) {
+            if (parent)
+                raler(1, "futex");
+            CHKS(-1);
+        }
+        atomic_fetch_sub(&c->attente, 1);
+        if (parent)
+            verifier_sigusr2();
+    }
+}
+
+// passe le créneau à l'étape suivante (publie aussi x et p)
+void publier_etape(struct creneau *c, unsigned etape) {
+    atomic_store(&c->etape, etape);
+    if (atomic_load(&c->attente) > 0)
+        futex(&c->etape, FUTEX_WAKE_BITSET, INT32_MAX, NULL,
+              1u << (etape % 32));
+}
+
+void child_pipeline(int ai, int moi, int k) {
+    struct Data data;
+    struct creneau *c;
+
+    for (int x = 1; x <= k; x++) {
+        c = &cren[(x - 1) % prof];
+        attendre_etape(c, moi, 0);
+
+        data.x = c->x;
+        data.p = c->p;
+        horner_aixi(&data, ai);
+        c->p = data.p;
+
+        publier_etape(c, moi + 1);
+    }
+    exit(0);
+}
+
+// le père injecte les x et récupère les résultats dans l'ordre
+void parent_pipeline(int n, int k) {
+    struct creneau *c;
+
+    for (int x = 1; x <= k && x <= prof; x++) {
+        c = &cren[x - 1];
+        c->x = x;
+        c->p = 0;
+        publier_etape(c, 0);
+    }
+
+    for (int x = 1; x <= k; x++) {
+        c = &cren[(x - 1) % prof];
+        attendre_etape(c, n + 1, 1);
 
-            write_data(fd, &data, 0);
+        printf("%d\n", c->p);
 
-            lseek(fd, (data.i - 1) * sizeof(int), SEEK_CUR);
-            CHKS(read(fd, &pid, sizeof(pid)));
-            CHKS(kill(pid, SIGUSR1)); // send sigusr1 to next process
+        if (x + prof <= k) {
+            c->x = x + prof;
+            c->p = 0;
+            publier_etape(c, 0);
         }
     }
-    s2_recu = 0;
+}
+
+/*
+ * Mode différences finies (-d) : pour x = 1, 2, ..., k consécutifs, la
+ * valeur suivante s'obtient par n additions et aucune multiplication.
+ * Avec D0(x) = p(x) et Dm(x) = Dm-1(x+1) - Dm-1(x), Dn est constante et
+ * Dm(x+1) = Dm(x) + Dm+1(x).
+ * Le fils placé en position i détient D(n-i) : à chaque tour, il reçoit
+ * dans le jeton l'ancienne valeur de D(n-i+1), transmet la sienne, puis
+ * ajoute la valeur reçue pendant que le jeton continue. Le dernier fils
+ * transmet donc p(x) au père. La table initiale est calculée par le père
+ * à partir de p(1) ... p(m) (Horner), m = min(k, n+1) : p(1) ... p(k) ne
+ * dépendent que des différences d'ordre < k, les autres restent nulles
+ * et une valeur jamais affichée ne peut pas provoquer d'erreur. Les
+ * différences sont sur 64 bits, mais p(x) doit tenir sur un int comme
+ * dans les autres modes : le dernier fils vérifie chaque valeur avant
+ * de la transmettre.
+ * Ce mode implique -m : le jeton est dans la projection partagée.
+ */
+void table_differences(int n, int k, char *coef[]) {
+    int m = k < n + 1 ? k : n + 1;
+    int64_t p, a;
+
+    CHKN(diff = calloc(n + 1, sizeof *diff));
+    for (int x = 1; x <= m; x++) {
+        p = 0;
+        for (int j = n; j >= 0; j--) {
+            a = atoi(coef[j]);
+            if (__builtin_mul_overflow(p, x, &p) ||
+                __builtin_add_overflow(p, a, &p))
+                raler(0, "dépassement de capacité pour x = %d", x);
+        }
+        diff[x - 1] = p;
+    }
+    // en place : diff[o] devient Do(1)
+    for (int o = 1; o < m; o++)
+        for (int j = m - 1; j >= o; j--)
+            if (__builtin_sub_overflow(diff[j], diff[j - 1], &diff[j]))
+                raler(0, "dépassement de capacité (différence d'ordre %d)", o);
+}
+
+void child_difference(int64_t d, int moi, int n, int k) {
+    int64_t t;
+
+    for (int x = 1; x <= k && attendre(moi, 0); x++) {
+        if (moi == n && (d > INT_MAX || d < INT_MIN)) { // d = p(x)
+            CHKS(prevenir_pere());
+            raler(0, "dépassement de capacité pour x = %d", x);
+        }
+        atomic_thread_fence(memory_order_acquire);
+        t = shm->jeton;
+        shm->jeton = d;
+        atomic_thread_fence(memory_order_release);
+        notifier(-1, moi + 1, 0);
+
+        // après le k-ième tour, la nouvelle différence ne servirait plus
+        if (moi > 0 && x < k && __builtin_add_overflow(d, t, &d)) {
+            CHKS(prevenir_pere());
+            raler(0, "dépassement de capacité pour x = %d", x + 1);
+        }
+    }
+    free(efd);
+    exit(0);
+}
+
+// le père lance chaque tour et récupère p(x) dans l'ordre
+void parent_difference(int n, int k) {
+    for (int x = 1; x <= k; x++) {
+        notifier(-1, 0, 1);
+        attendre(n + 1, 1);
+        atomic_thread_fence(memory_order_acquire);
+        printf("%d\n", (int)shm->jeton);
+    }
+}
+
+/*
+ * Mode par lots (-b lot) : chaque tour d'anneau porte lot valeurs de x
+ * consécutives au lieu d'une, et chaque fils applique son pas de Horner
+ * p = p * x + a(n-i) à tout le lot. Les calculs se font sur des vecteurs
+ * de VOIES entiers de 64 bits (extensions vectorielles de gcc) : une
+ * instruction AVX-512, deux AVX2, ou la traduction générique (SSE2 ou
+ * scalaire) selon le processeur, choisie au démarrage. Comme p et x
+ * tiennent sur un int, p * x + a ne déborde pas sur 64 bits : comme
+ * dans horner_aixi(), seule la valeur transmise doit tenir sur un int,
+ * ce qui est vérifié par comparaison ; en cas d'erreur, le lot fautif
+ * n'est pas affiché. Les voies au-delà du dernier x ont x = 0 et ne
+ * sont pas affichées. Le lot est borné par LOT_MAX et par k, ce qui
+ * borne aussi la projection. Ce mode implique -H et -m.
+ */
+#define VOIES 8
+
+typedef int64_t mots64 __attribute__((vector_size(VOIES * sizeof(int64_t))));
+
+// renvoie le rang de la première voie qui déborde, -1 si aucune
+static inline __attribute__((always_inline)) int
+corps_pas_lot(int64_t *p, const int64_t *x, int n, int64_t a) {
+    mots64 hors = {0}, v;
+    int deborde = 0;
+
+    for (int j = 0; j < n; j += VOIES) {
+        mots64 *vp = (mots64 *)(p + j);
+        v = *vp * *(const mots64 *)(x + j) + a;
+        hors |= (v > INT_MAX) | (v < INT_MIN);
+        *vp = v;
+    }
+    for (int j = 0; j < VOIES; j++)
+        deborde |= hors[j] != 0;
+    if (deborde) // rare : retrouver la première voie fautive
+        for (int i = 0; i < n; i++)
+            if (p[i] > INT_MAX || p[i] < INT_MIN)
+                return i;
+    return -1;
+}
+
+int pas_lot_generique(int64_t *p, const int64_t *x, int n, int64_t a) {
+    return corps_pas_lot(p, x, n, a);
+}
+
+#if defined(__x86_64__)
+__attribute__((target("avx2"))) int
+pas_lot_avx2(int64_t *p, const int64_t *x, int n, int64_t a) {
+    return corps_pas_lot(p, x, n, a);
+}
+
+__attribute__((target("avx512f,avx512dq"))) int
+pas_lot_avx512(int64_t *p, const int64_t *x, int n, int64_t a) {
+    return corps_pas_lot(p, x, n, a);
+}
+#endif
+
+int (*pas_lot)(int64_t *p, const int64_t *x, int n,
+               int64_t a) = pas_lot_generique;
+
+void pas_lot_init(void) {
+#if defined(__x86_64__)
+    if (__builtin_cpu_supports("avx512f") &&
+        __builtin_cpu_supports("avx512dq"))
+        pas_lot = pas_lot_avx512;
+    else if (__builtin_cpu_supports("avx2"))
+        pas_lot = pas_lot_avx2;
+#endif
+}
+
+void child_lot(int ai, int moi) {
+    int j;
+
+    while (attendre(moi, 0)) {
+        atomic_thread_fence(memory_order_acquire);
+        if ((j = pas_lot(lot_p, lot_x, largeur, ai)) != -1) {
+            CHKS(prevenir_pere());
+            raler(0, "dépassement de capacité pour x = %d", (int)lot_x[j]);
+        }
+        atomic_thread_fence(memory_order_release);
+        notifier(-1, moi + 1, 0);
+    }
+    free(efd);
+    exit(0);
+}
+
+// le père injecte les lots dans l'ordre des x et affiche les résultats
+void parent_lot(int n, int k) {
+    int m;
+
+    for (int x = 1; x <= k; x += lot) {
+        m = k - x + 1 < lot ? k - x + 1 : lot;
+        for (int j = 0; j < largeur; j++) {
+            lot_x[j] = j < m ? x + j : 0;
+            lot_p[j] = 0;
+        }
+        atomic_thread_fence(memory_order_release);
+        notifier(-1, 0, 1);
+        attendre(n + 1, 1);
+        atomic_thread_fence(memory_order_acquire);
+        for (int j = 0; j < m; j++)
+            printf("%d\n", (int)lot_p[j]);
+    }
+}
+
+void child(int fd, int ai, int horner, int moi) {
+    struct Data data;
+
+    while (attendre(moi, 0)) {
+        read_data(fd, &data, 0);
+
+        if (horner)
+            horner_aixi(&data, ai);
+        else
+            calculate_aixi(&data, ai);
+
+        write_data(fd, &data, 0);
+
+        notifier(fd, data.i, 0); // notify next process
+    }
+    free(efd);
     exit(0);
 }
 
 int main(int argc, char *argv[]) {
+    int opt, horner = 0, partage = 0, chrono = 0, differences = 0;
+
+    // "+" : les coefficients négatifs ne sont pas des options
+    while ((opt = getopt(argc, argv, "+Hmn:s:p:db:t")) != -1) {
+        switch (opt) {
+        case 'H':
+            horner = 1;
+            break;
+        case 'm':
+            partage = 1;
+            break;
+        case 'n':
+            if (strcmp(optarg, "signal") == 0)
+                notif = NOTIF_SIGNAL;
+            else if (strcmp(optarg, "eventfd") == 0)
+                notif = NOTIF_EVENTFD;
+            else if (strcmp(optarg, "futex") == 0) {
+                notif = NOTIF_FUTEX;
+                partage = 1; // les mots futex sont dans la projection
+            } else
+                raler(0, USAGE);
+            break;
+        case 's':
+            spin = atoi(optarg);
+            if (spin < 0)
+                raler(0, USAGE);
+            break;
+        case 'p':
+            prof = atoi(optarg);
+            if (prof <= 0)
+                raler(0, USAGE);
+            horner = partage = 1;
+            break;
+        case 'd':
+            differences = partage = 1;
+            break;
+        case 'b':
+            lot = atoi(optarg);
+            if (lot <= 0 || lot > LOT_MAX)
+                raler(0, USAGE);
+            horner = partage = 1;
+            break;
+        case 't':
+            chrono = 1;
+            break;
+        default:
+            raler(0, USAGE);
+        }
+    }
+    argc -= optind - 1;
+    argv += optind - 1;
+
     if (argc < 4)
-        raler(0, "usage : poly k f a0 ... an");
+        raler(0, USAGE);
 
     int n = argc - 4; // coeff index start at 0
     int k = atoi(argv[1]);
 
-    if (k <= 0 || n < 0)
-        raler(0, "usage : poly k f a0 ... an");
+    if (k <= 0 || n < 0 || differences + (prof > 0) + (lot > 0) > 1)
+        raler(0, USAGE);
+    if (lot > k) // un seul tour : inutile de projeter plus de k voies
+        lot = k;
+    largeur = (lot + VOIES - 1) / VOIES * VOIES;
 
     int fd, raison, running;
-    pid_t pid, first_pid;
+    pid_t pid, pere = getpid();
     struct Data data = {n, 0, 1, 0}; // n, i, x, p
     struct sigaction s;
-    sigset_t empty, old, new;
+    sigset_t old, new;
+    struct timespec debut, fin;
 
     s.sa_flags = 0;
     CHK(sigemptyset(&s.sa_mask));
-    CHK(sigemptyset(&empty));
 
     s.sa_handler = recv_sigusr1;
     CHK(sigaction(SIGUSR1, &s, NULL));
@@ -179,10 +791,38 @@ int main(int argc, char *argv[]) {
     s.sa_handler = recv_sigusr2;
     CHK(sigaction(SIGUSR2, &s, NULL));
 
-    // open in reading and writing
-    CHK(fd = open(argv[2], O_RDWR | O_TRUNC | O_CREAT, 0666));
-    // write data to file, n, i, x, p
-    CHK(write(fd, &data, sizeof(struct Data)));
+    if (partage) {
+        // le fichier f n'est pas utilisé : tout l'état est en mémoire
+        fd = -1;
+        shm = mmap(NULL, taille_partage(n), PROT_READ | PROT_WRITE,
+                   MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+        if (shm == MAP_FAILED)
+            raler(1, "mmap");
+        shm->data = data;
+        char *suite = (char *)shm + taille_entete(n);
+        if (notif == NOTIF_FUTEX) {
+            rev = (struct reveil *)suite;
+            suite += (n + 2) * sizeof(struct reveil);
+        }
+        if (prof > 0) {
+            // étape n+1 : créneau libre, aucun fils ne l'attend
+            cren = (struct creneau *)suite;
+            for (int j = 0; j < prof; j++)
+                atomic_store(&cren[j].etape, n + 1);
+            suite += prof * sizeof(struct creneau);
+        }
+        if (lot > 0) {
+            // alignés sur 64 octets : tout ce qui précède l'est aussi
+            lot_x = (int64_t *)suite;
+            lot_p = lot_x + largeur;
+            pas_lot_init();
+        }
+    } else {
+        // open in reading and writing
+        CHK(fd = open(argv[2], O_RDWR | O_TRUNC | O_CREAT, 0666));
+        // write data to file, n, i, x, p
+        CHK(write(fd, &data, sizeof(struct Data)));
+    }
 
     // set mask to block SIGUSR1 and SIGUSR2
     CHK(sigemptyset(&new));
@@ -191,19 +831,41 @@ int main(int argc, char *argv[]) {
 
     CHK(sigprocmask(SIG_BLOCK, &new, &old));
 
+    if (notif == NOTIF_EVENTFD) {
+        CHKN(efd = malloc((n + 2) * sizeof(int)));
+        for (int j = 0; j <= n + 1; ++j)
+            CHK(efd[j] = eventfd(0, 0));
+    }
+
+    if (differences)
+        table_differences(n, k, argv + 3);
+
     // create n+1 children
     for (int i = 0; i <= n; ++i) {
-        switch (pid = fork()) {
+        switch (pid = lance_fork()) {
         case -1:
             raler(1, "fork");
         case 0:
-            // child
-            child(fd, atoi(argv[i + 3]));
+            // le père s'arrête sur une erreur sans prévenir l'anneau
+            // (dépassement de capacité) : les fils ne lui survivent pas
+            CHKS(prctl(PR_SET_PDEATHSIG, SIGKILL));
+            if (getppid() != pere)
+                exit(1);
+            // child : avec Horner, l'anneau parcourt an ... a0
+            if (prof > 0)
+                child_pipeline(atoi(argv[n - i + 3]), i, k);
+            if (differences)
+                child_difference(diff[n - i], i, n, k);
+            if (lot > 0)
+                child_lot(atoi(argv[n - i + 3]), i);
+            child(fd, atoi(argv[horner ? n - i + 3 : i + 3]), horner, i);
             exit(0); // cordon sanitaire
         default:
             // parent
             if (i == 0) {
                 first_pid = pid; // first child pid, dont write to file
+            } else if (shm != NULL) {
+                shm->pid[i - 1] = pid;
             } else {
                 CHK(write(fd, &pid, sizeof(pid)));
             }
@@ -212,53 +874,63 @@ int main(int argc, char *argv[]) {
     }
 
     pid = getpid(); // parent pid
-    CHK(write(fd, &pid, sizeof(pid)));
+    if (shm != NULL) {
+        shm->pid[n] = pid;
+        atomic_thread_fence(memory_order_release);
+    } else {
+        CHK(write(fd, &pid, sizeof(pid)));
+    }
 
-    CHK(kill(first_pid, SIGUSR1)); // send first sigusr1 to first child
+    CHK(clock_gettime(CLOCK_MONOTONIC, &debut));
+
+    if (prof > 0) {
+        // les fils se terminent d'eux-mêmes après le k-ième x
+        parent_pipeline(n, k);
+        running = 0;
+    } else if (differences) {
+        // idem après le k-ième tour
+        parent_difference(n, k);
+        running = 0;
+    } else if (lot > 0) {
+        parent_lot(n, k);
+        running = 0;
+    } else {
+        notifier(fd, 0, 1); // notify first child
+        running = 1;
+    }
 
-    running = 1;
     while (running) {
+        attendre(n + 1, 1);
 
-        sigsuspend(&empty);
+        read_data(fd, &data, 1);
 
-        if (s2_recu)
-            raler(0, "fils mal terminé\n");
+        printf("%d\n", data.p);
 
-        if (s1_recu) {
-            s1_recu = 0;
-
-            read_data(fd, &data, 1);
-
-            printf("%d\n", data.p);
-
-            if (data.x >= k) {
-                running = 0;
-                continue;
-            }
-            data.x += 1;
-            data.p = 0;
-            data.i = 0;
+        if (data.x >= k) {
+            running = 0;
+            continue;
+        }
+        data.x += 1;
+        data.p = 0;
+        data.i = 0;
 
-            write_data(fd, &data, 1);
+        write_data(fd, &data, 1);
 
-            CHK(kill(first_pid, SIGUSR1)); // send sigusr1 to first child;
-        }
+        notifier(fd, 0, 1); // notify first child
     }
 
-    // send sigusr2 to all children
-    CHK(kill(first_pid, SIGUSR2));
-    lseek(fd, sizeof(struct Data), SEEK_SET);
-    for (int j = 0; j < n; ++j) {
-        CHK(read(fd, &pid, sizeof(pid)));
-        CHK(kill(pid, SIGUSR2));
-    }
+    CHK(clock_gettime(CLOCK_MONOTONIC, &fin));
+
+    // ask all children to terminate
+    if (prof == 0 && !differences)
+        terminer(fd, n);
 
     // unblock SIGUSR1 and SIGUSR2
     CHK(sigprocmask(SIG_SETMASK, &old, NULL));
 
     // wait for n+1 children
     for (int i = 0; i <= n; ++i) {
-        CHK(wait(&raison));
+        CHK(lance_attendre(&raison));
         if (!(WIFEXITED(raison) && WEXITSTATUS(raison) == 0)) {
             if (WIFEXITED(raison))
                 raler(0, "fils mal terminé exit %d", WEXITSTATUS(raison));
@@ -269,8 +941,32 @@ int main(int argc, char *argv[]) {
         }
     }
 
-    CHK(close(fd));
-    unlink(argv[2]); // delete file
+    if (chrono) {
+        // un tour d'anneau = n+1 fils + le père, un tour par lot
+        double ns = (fin.tv_sec - debut.tv_sec) * 1e9 +
+                    (fin.tv_nsec - debut.tv_nsec);
+        long tours = lot > 0 ? (k + lot - 1) / lot : k;
+        long sauts = tours * (n + 2);
+        fprintf(stderr,
+                "%d processus, %ld sauts, %.0f ns/saut, %.0f sauts/s, "
+                "%.0f valeurs/s\n",
+                n + 2, sauts, ns / sauts, sauts / ns * 1e9, k / ns * 1e9);
+    }
+
+    free(diff);
+
+    if (efd != NULL) {
+        for (int j = 0; j <= n + 1; ++j)
+            CHK(close(efd[j]));
+        free(efd);
+    }
+
+    if (shm != NULL) {
+        CHK(munmap(shm, taille_partage(n)));
+    } else {
+        CHK(close(fd));
+        unlink(argv[2]); // delete file
+    }
 
     exit(0);
 }
\ No newline at end of file
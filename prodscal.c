@@ -1,24 +1,34 @@
 #include <errno.h>
 #include <inttypes.h>
+#include <limits.h>
 #include <stdarg.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdnoreturn.h>
 #include <string.h>
-#include <sys/types.h>
-#include <sys/wait.h>
+#include <time.h>
 #include <unistd.h>
 
+#include "mapreduce.h"
+
 #define CHK(op)                                                                \
     do {                                                                       \
         if ((op) == -1)                                                        \
             raler(1, #op);                                                     \
     } while (0)
+#define CHKN(op)                                                               \
+    do {                                                                       \
+        if ((op) == NULL)                                                      \
+            raler(1, #op);                                                     \
+    } while (0)
 
-struct couple {
-    int x;
-    int y;
-};
+#define USAGE                                                                  \
+    "usage: prodscal [-t] [-m tube|shm|threads] [-o operation] [-v]\n"       \
+    "                c|auto vecteurs\n"                                      \
+    "       operation = produit (x1 ... xn y1 ... yn, par défaut)\n"          \
+    "                 | pondere (x1 ... xn y1 ... yn w1 ... wn)\n"            \
+    "                 | norme2 | minmax | histo (x1 ... xn)"
 
 noreturn void raler(int syserr, const char *fmt, ...) {
     va_list ap;
@@ -32,105 +42,312 @@ noreturn void raler(int syserr, const char *fmt, ...) {
     exit(1);
 }
 
-void fils_multiplieur(int tube1[], int tube2[]) {
-    ssize_t nlus;
-    struct couple couple;
-    int produit;
+/*
+ * Opérations offertes par le moteur map-reduce (mapreduce.h). Chacune
+ * lit k vecteurs de n entiers, regroupés élément par élément.
+ */
+struct couple {
+    int x;
+    int y;
+};
 
-    CHK(close(tube1[1]));
-    CHK(close(tube2[0]));
+struct triplet {
+    int x, y, w;
+};
 
-    while ((nlus = read(tube1[0], &couple, sizeof couple)) > 0) {
-        produit = couple.x * couple.y;
-        CHK(write(tube2[1], &produit, sizeof produit));
-    }
-    CHK(nlus);
+struct extremes {
+    int min, max;
+};
 
-    CHK(close(tube1[0]));
-    CHK(close(tube2[1]));
-}
+#define NB_CLASSES 33 // histogramme : nombre de bits significatifs de |x|
+struct histo {
+    int64_t nb[NB_CLASSES];
+};
 
-void fils_additionneur(int tube1[], int tube2[]) {
-    ssize_t nlus;
-    int somme, xiyi;
+static int classe(int x) {
+    unsigned v = x < 0 ? -(unsigned)x : (unsigned)x;
+    int b = 0;
 
-    CHK(close(tube1[0]));
-    CHK(close(tube1[1]));
-    CHK(close(tube2[1]));
+    while (v != 0)
+        b++, v >>= 1;
+    return b;
+}
 
-    somme = 0;
-    while ((nlus = read(tube2[0], &xiyi, sizeof xiyi)) > 0)
-        somme += xiyi;
-    CHK(nlus);
+// produit scalaire en int, comme la version historique
+MR_OPERATEUR(produit, struct couple, int, *a = 0, *a += e[i].x * e[i].y,
+             *a += *b);
+MR_OPERATEUR(pondere, struct triplet, int64_t, *a = 0,
+             *a += (int64_t)e[i].x * e[i].y * e[i].w, *a += *b);
+MR_OPERATEUR(norme2, int, int64_t, *a = 0, *a += (int64_t)e[i] * e[i],
+             *a += *b);
+MR_OPERATEUR(minmax, int, struct extremes,
+             (a->min = INT32_MAX, a->max = INT32_MIN),
+             (a->min = e[i] < a->min ? e[i] : a->min,
+              a->max = e[i] > a->max ? e[i] : a->max),
+             (a->min = b->min < a->min ? b->min : a->min,
+              a->max = b->max > a->max ? b->max : a->max));
+MR_OPERATEUR(histo, int, struct histo, memset(a, 0, sizeof *a),
+             a->nb[classe(e[i])]++,
+             for (int k = 0; k < NB_CLASSES; k++) a->nb[k] += b->nb[k]);
 
-    CHK(close(tube2[0]));
+const struct {
+    const struct mr_op *op;
+    int k; // nombre de vecteurs
+} operations[] = {
+    {&produit, 2}, {&pondere, 3}, {&norme2, 1}, {&minmax, 1}, {&histo, 1},
+};
 
-    printf("%d\n", somme);
+void afficher(const struct mr_op *op, const void *res) {
+    if (op == &produit)
+        printf("%d\n", *(const int *)res);
+    else if (op == &pondere || op == &norme2)
+        printf("%" PRId64 "\n", *(const int64_t *)res);
+    else if (op == &minmax) {
+        const struct extremes *m = res;
+        printf("%d %d\n", m->min, m->max);
+    } else {
+        // une ligne par classe non vide : bits de |x|, effectif
+        const struct histo *h = res;
+        for (int k = 0; k < NB_CLASSES; k++)
+            if (h->nb[k] > 0)
+                printf("%d %" PRId64 "\n", k, h->nb[k]);
+    }
 }
 
-int main(int argc, char *argv[]) {
-    int tube1[2], tube2[2];
-    int c, n;
-    int raison;
-    struct couple couple;
+/*
+ * c = auto : le nombre d'ouvriers (et la taille des lots du transport
+ * tube) est choisi par une calibration sur un échantillon des données :
+ * c de 1 à 2 fois le nombre de processeurs en ligne (sans dépasser le
+ * nombre d'éléments), chaque essai gardant le meilleur de ESSAIS
+ * exécutions. Le résultat est gardé dans un fichier de réglages
+ * (PRODSCAL_CONF, sinon ~/.prodscal), par machine, transport,
+ * opération et ordre de grandeur de n : les exécutions suivantes
+ * partent directement du meilleur réglage. Ce fichier n'est qu'un
+ * cache : s'il ne peut être ni lu ni écrit, la calibration est refaite
+ * à chaque exécution (avec un message si -v).
+ */
+#define ECHANTILLON 65536 // éléments au plus pour la calibration
+#define ESSAIS 3
 
-    if (argc < 4 || argc % 2 != 0)
-        raler(0, "usage: prodscal c x1 ... xn y1 ... yn");
+struct reglage {
+    int c;
+    size_t lot; // mr_lot
+};
 
-    c = atoi(argv[1]);
-    if (c <= 0)
-        raler(0, "usage: prodscal c x1 ... xn y1 ... yn");
+double maintenant(void) {
+    struct timespec ts;
+    CHK(clock_gettime(CLOCK_MONOTONIC, &ts));
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
 
-    n = (argc - 2) / 2;
+// NULL : pas de fichier de réglages (pas de HOME)
+const char *fichier_reglages(char *nom, size_t taille) {
+    const char *s;
 
-    CHK(pipe(tube1));
-    CHK(pipe(tube2));
+    if ((s = getenv("PRODSCAL_CONF")) != NULL)
+        return s;
+    if ((s = getenv("HOME")) == NULL)
+        return NULL;
+    if (snprintf(nom, taille, "%s/.prodscal", s) >= (int)taille)
+        return NULL;
+    return nom;
+}
 
-    for (int j = 0; j <= c; j++) {
-        switch (fork()) {
-        case -1:
-            raler(1, "cannot fork child %d", j);
+void cle_reglage(char *cle, size_t taille, const struct mr_op *op, int t,
+                 size_t n) {
+    char machine[HOST_NAME_MAX + 1];
+    int ordre = 0;
 
-        case 0:
-            if (j < c)
-                fils_multiplieur(tube1, tube2);
-            else
-                fils_additionneur(tube1, tube2);
-            exit(0);
+    CHK(gethostname(machine, sizeof machine));
+    machine[HOST_NAME_MAX] = '\0';
+    while ((n >>= 1) != 0)
+        ordre++;
+    snprintf(cle, taille, "%s:%ld:%s:%s:%d", machine,
+             sysconf(_SC_NPROCESSORS_ONLN), mr_nom(t), op->nom, ordre);
+}
 
-        default:
-            // surtout ne rien faire
-            break;
+// une ligne par réglage : "clé c lot", la clé lue est bornée à CLE_MAX
+#define CLE_MAX 1023
+#define FORMAT_REGLAGE "%1023s %d %zu"
+
+int lire_reglage(const char *fich, const char *cle, struct reglage *r) {
+    char lue[CLE_MAX + 1];
+    int c, trouve = 0;
+    size_t lot;
+    FILE *fp;
+
+    if ((fp = fopen(fich, "r")) == NULL) // absent ou illisible : calibrer
+        return 0;
+    while (!trouve && fscanf(fp, FORMAT_REGLAGE, lue, &c, &lot) == 3) {
+        if (strcmp(lue, cle) == 0 && c > 0) {
+            r->c = c;
+            r->lot = lot;
+            trouve = 1;
         }
     }
+    CHK(fclose(fp) == EOF ? -1 : 0);
+    return trouve;
+}
+
+/*
+ * Réécrit le fichier par renommage, la clé remplaçant l'ancienne valeur.
+ * Le fichier n'est qu'un cache : en cas d'échec, le fichier temporaire
+ * est supprimé et -1 renvoyé (errno positionné), sans arrêter le calcul.
+ */
+int ecrire_reglage(const char *fich, const char *cle,
+                   const struct reglage *r) {
+    char tmp[PATH_MAX], lue[CLE_MAX + 1];
+    FILE *ancien, *nouveau;
+    size_t lot;
+    int c, err;
+
+    if (snprintf(tmp, sizeof tmp, "%s.%d", fich, getpid()) >= (int)sizeof tmp) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    if ((nouveau = fopen(tmp, "w")) == NULL)
+        return -1;
+    if ((ancien = fopen(fich, "r")) != NULL) {
+        while (fscanf(ancien, FORMAT_REGLAGE, lue, &c, &lot) == 3)
+            if (strcmp(lue, cle) != 0)
+                fprintf(nouveau, "%s %d %zu\n", lue, c, lot);
+        fclose(ancien); // lecture seule : rien à perdre
+    } else if (errno != ENOENT) {
+        // illisible : ne pas écraser les autres réglages
+        err = errno;
+        fclose(nouveau);
+        goto erreur;
+    }
+    fprintf(nouveau, "%s %d %zu\n", cle, r->c, r->lot);
+    if (fclose(nouveau) == EOF || rename(tmp, fich) == -1) {
+        err = errno;
+        goto erreur;
+    }
+    return 0;
 
-    CHK(close(tube1[0]));
-    CHK(close(tube2[0]));
-    CHK(close(tube2[1]));
+erreur:
+    unlink(tmp);
+    errno = err;
+    return -1;
+}
 
-    // injecter les couples (xi,yi) dans le premier tube
+double essayer(const struct mr_op *op, int t, const struct reglage *r,
+               const void *elts, size_t n) {
+    int64_t res[NB_CLASSES];
+    double meilleur = 0, debut, d;
 
-    for (int i = 0; i < n; i++) {
-        couple.x = atoi(argv[2 + i]);
-        couple.y = atoi(argv[2 + n + i]);
-        CHK(write(tube1[1], &couple, sizeof couple));
+    mr_lot = r->lot;
+    for (int i = 0; i < ESSAIS; i++) {
+        debut = maintenant();
+        mr_lancer(op, t, r->c, elts, n, res);
+        d = maintenant() - debut;
+        if (i == 0 || d < meilleur)
+            meilleur = d;
     }
+    return meilleur;
+}
+
+void calibrer(const struct mr_op *op, int t, const void *elts, size_t n,
+              struct reglage *r) {
+    // lots du transport tube, en octets (0 : PIPE_BUF)
+    const size_t lots[] = {PIPE_BUF / 16, PIPE_BUF / 4, 0};
+    long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+    size_t m = n < ECHANTILLON ? n : ECHANTILLON;
+    struct reglage essai;
+    double d, meilleur = 0;
+
+    r->c = 1;
+    r->lot = 0;
+    for (essai.c = 1; essai.c <= 2 * ncpu && (size_t)essai.c <= m;
+         essai.c *= 2) {
+        for (int l = 0; l < (t == MR_TUBE ? 3 : 1); l++) {
+            essai.lot = t == MR_TUBE ? lots[l] / op->taille_elt : 0;
+            d = essayer(op, t, &essai, elts, m);
+            if ((essai.c == 1 && l == 0) || d < meilleur) {
+                meilleur = d;
+                *r = essai;
+            }
+        }
+    }
+}
 
-    CHK(close(tube1[1]));
+void regler(const struct mr_op *op, int t, const void *elts, size_t n,
+            int verbeux, struct reglage *r) {
+    char nom[PATH_MAX], cle[HOST_NAME_MAX + 64];
+    const char *fich = fichier_reglages(nom, sizeof nom);
+    int connu;
 
-    // attendre la terminaison des fils
+    cle_reglage(cle, sizeof cle, op, t, n);
+    if (!(connu = fich != NULL && lire_reglage(fich, cle, r))) {
+        calibrer(op, t, elts, n, r);
+        if (fich != NULL && ecrire_reglage(fich, cle, r) == -1 && verbeux)
+            fprintf(stderr, "auto : réglage non gardé dans %s (%s)\n", fich,
+                    strerror(errno));
+    }
+    if (verbeux)
+        fprintf(stderr, "auto : c=%d lot=%zu (%s)\n", r->c, r->lot,
+                connu ? "réglage gardé" : "calibration");
+}
+
+int main(int argc, char *argv[]) {
+    int c, n, k, opt, t = MR_TUBE, o = 0, verbeux = 0, autom;
+    struct reglage r;
+    int *elts;
+    int64_t res[NB_CLASSES]; // assez grand pour tout accumulateur
 
-    for (int j = 0; j <= c; j++) {
-        CHK(wait(&raison));
-        if (!(WIFEXITED(raison) && WEXITSTATUS(raison) == 0)) {
-            if (WIFEXITED(raison))
-                raler(0, "fils mal terminé exit %d", WEXITSTATUS(raison));
-            else if (WIFSIGNALED(raison))
-                raler(0, "fils mal terminé signal %d", WTERMSIG(raison));
-            else
-                raler(0, "fils mal terminé raison inconnue");
+    // "+" : s'arrêter au premier argument qui n'est pas une option, les
+    // valeurs négatives des vecteurs ne doivent pas être prises pour -x
+    while ((opt = getopt(argc, argv, "+tm:o:v")) != -1) {
+        switch (opt) {
+        case 't':
+            t = MR_THREADS;
+            break;
+        case 'm':
+            if ((t = mr_choisir(optarg)) == -1)
+                raler(0, USAGE);
+            break;
+        case 'v':
+            verbeux = 1;
+            break;
+        case 'o':
+            for (o = 0; o < (int)(sizeof operations / sizeof operations[0]);
+                 o++)
+                if (strcmp(optarg, operations[o].op->nom) == 0)
+                    break;
+            if (o == sizeof operations / sizeof operations[0])
+                raler(0, USAGE);
+            break;
+        default:
+            raler(0, USAGE);
         }
     }
+    argc -= optind - 1;
+    argv += optind - 1;
+
+    k = operations[o].k;
+    if (argc < 2 + k || (argc - 2) % k != 0)
+        raler(0, USAGE);
+
+    autom = strcmp(argv[1], "auto") == 0;
+    c = autom ? 0 : atoi(argv[1]);
+    if (!autom && c <= 0)
+        raler(0, USAGE);
+
+    // élément i : (v1[i], ..., vk[i]), le moteur ne voit que des octets
+    n = (argc - 2) / k;
+    CHKN(elts = malloc((size_t)n * k * sizeof *elts));
+    for (int i = 0; i < n; i++)
+        for (int v = 0; v < k; v++)
+            elts[i * k + v] = atoi(argv[2 + v * n + i]);
+
+    if (autom) {
+        regler(operations[o].op, t, elts, n, verbeux, &r);
+        c = r.c;
+        mr_lot = r.lot;
+    }
+    mr_lancer(operations[o].op, t, c, elts, n, res);
+    afficher(operations[o].op, res);
 
+    free(elts);
     exit(0);
 }
@@ -3,16 +3,23 @@
 #include <fcntl.h>
 #include <signal.h>
 #include <stdarg.h>
+#include <stdatomic.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdnoreturn.h>
 #include <string.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
+#include <sys/syscall.h>
 #include <sys/types.h>
 #include <sys/wait.h>
+#include <time.h>
 #include <unistd.h>
 
+#include "lancement.h"
+
 #define CHK(op)                                                                \
     do {                                                                       \
         if ((op) == -1)                                                        \
@@ -27,6 +34,9 @@
         }                                                                      \
     } while (0)
 
+#define USAGE                                                                  \
+    "usage: ronde [-m] [-d kill|groupe|barriere] [-t] fichier v0 ... vn-1"
+
 noreturn void raler(int syserr, const char *fmt, ...) {
     va_list ap;
     va_start(ap, fmt);
@@ -41,7 +51,7 @@ noreturn void raler(int syserr, const char *fmt, ...) {
 void args(int argc, const char *argv[], const char **fich, int tv[], int *pn) {
     int n = argc - 2;
     if (argc < 3)
-        raler(0, "usage: ronde fichier v0 ... vn-1");
+        raler(0, USAGE);
 
     *fich = argv[1];
     if (*pn < n)
@@ -83,6 +93,7 @@ void preparer_signaux(void) {
     CHK(sigemptyset(&s.sa_mask));
     CHK(sigemptyset(&empty));
     CHK(sigaction(SIGUSR1, &s, NULL));
+    CHK(sigaction(SIGUSR2, &s, NULL));
 
     CHK(sigemptyset(&new));
     CHK(sigaddset(&new, SIGUSR1));
@@ -91,26 +102,126 @@ void preparer_signaux(void) {
     CHK(sigprocmask(SIG_BLOCK, &new, &old));
 }
 
+// attend le signal indiqué ; l'autre peut arriver entre-temps
 void attendre_signal(int signum) {
     sigset_t vide;
+    volatile sig_atomic_t *recu = signum == SIGUSR1 ? &recu1 : &recu2;
     CHK(sigemptyset(&vide));
 
-    while (!recu1 && !recu2) {
+    while (!*recu) {
         sigsuspend(&vide);
     }
+    *recu = 0;
+}
+
+/*
+ * Table partagée (-m) : une case par processus, sur sa propre ligne de
+ * cache, projetée par lancer() avant les fork. Le processus i publie vi
+ * dans la case de son voisin (i+1) % n : écriture de la valeur puis
+ * publication "release" de l'état, que le voisin lit en "acquire".
+ * Le voisin ne dort (futex) que si la valeur n'est pas encore là, et
+ * l'écrivain ne fait l'appel système de réveil que dans ce cas.
+ */
+enum { VIDE, PUBLIE, ATTENTE }; // états d'une case
+
+struct case_ronde {
+    _Alignas(64) atomic_uint etat;
+    int val;
+};
+
+struct case_ronde *cases = NULL; // NULL : échange par fichier
+
+/*
+ * Démarrage et fin du tour (-d) :
+ * - kill : un SIGUSR1 par fils (comportement d'origine) ;
+ * - groupe : les fils forment un groupe de processus, un seul
+ *   kill(-pgid) les démarre tous ;
+ * - barriere : barrière à inversion de sens dans la projection (impose
+ *   -m). Le père est le dernier arrivé de la barrière de départ, ce qui
+ *   libère tous les fils par un seul FUTEX_WAKE ; une seconde barrière
+ *   lui indique la fin du tour sans attendre n terminaisons.
+ */
+enum demarrage { DEM_KILL, DEM_GROUPE, DEM_BARRIERE };
+
+struct barriere {
+    _Alignas(64) atomic_uint restants; // nb de processus encore attendus
+    _Alignas(64) atomic_uint sens;     // inversé à chaque passage
+    unsigned total;
+};
+
+enum demarrage demarrage = DEM_KILL;
+struct barriere *barr = NULL; // barr[0] : départ, barr[1] : fin
+unsigned sens_local[2];       // sens attendu par ce processus, par barrière
+
+long futex(atomic_uint *mot, int op, unsigned val) {
+    return syscall(SYS_futex, mot, op, val, NULL, NULL, 0);
 }
 
-void fils(const char *fichier, int i, int vi) {
+void publier(struct case_ronde *c, int val) {
+    c->val = val;
+    if (atomic_exchange_explicit(&c->etat, PUBLIE, memory_order_release) ==
+        ATTENTE)
+        CHK(futex(&c->etat, FUTEX_WAKE, 1));
+}
+
+int recevoir(struct case_ronde *c) {
+    unsigned e = VIDE;
+
+    if (atomic_compare_exchange_strong_explicit(&c->etat, &e, ATTENTE,
+                                                memory_order_acquire,
+                                                memory_order_acquire) ||
+        e == ATTENTE) {
+        while (atomic_load_explicit(&c->etat, memory_order_acquire) != PUBLIE)
+            if (futex(&c->etat, FUTEX_WAIT, ATTENTE) == -1 && errno != EAGAIN &&
+                errno != EINTR)
+                raler(1, "futex");
+    }
+    return c->val;
+}
+
+void barriere_attendre(struct barriere *b) {
+    unsigned *sl = &sens_local[b - barr];
+    unsigned s = *sl = !*sl;
+
+    if (atomic_fetch_sub(&b->restants, 1) == 1) {
+        // dernier arrivé : réarmer puis libérer tout le monde
+        atomic_store(&b->restants, b->total);
+        atomic_store(&b->sens, s);
+        CHK(futex(&b->sens, FUTEX_WAKE, INT32_MAX));
+    } else {
+        while (atomic_load(&b->sens) != s)
+            if (futex(&b->sens, FUTEX_WAIT, !s) == -1 && errno != EAGAIN &&
+                errno != EINTR)
+                raler(1, "futex");
+    }
+}
+
+void fils_partage(int i, int vi, int n) {
+    publier(&cases[(i + 1) % n], vi);
+    printf("%d\n", recevoir(&cases[i]));
+    if (barr != NULL) {
+        // la valeur est livrée avant que le père ne date la fin du tour
+        CHK(fflush(stdout));
+        barriere_attendre(&barr[1]);
+    }
+    exit(0);
+}
+
+void fils(const char *fichier, int i, int vi, int n) {
     int fd, val;
     pid_t pid;
 
-    while (!recu1) {
+    if (barr != NULL)
+        barriere_attendre(&barr[0]);
+    else
         attendre_signal(SIGUSR1);
-        recu1 = 0;
-    }
 
-    CHK(fd = open(fichier, O_RDWR | O_TRUNC | O_CREAT, 0666));
-    CHK(lseek(fd, (i + 1) * sizeof(int), SEEK_SET));
+    if (cases != NULL)
+        fils_partage(i, vi, n);
+
+    // la case du voisin contient son pid, qu'on remplace par notre valeur
+    CHK(fd = open(fichier, O_RDWR));
+    CHK(lseek(fd, (i + 1) % n * sizeof(int), SEEK_SET));
     CHK(read(fd, &pid, sizeof(pid_t)));
     CHK(lseek(fd, -sizeof(pid_t), SEEK_CUR));
     CHK(write(fd, &vi, sizeof(int)));
@@ -118,53 +229,140 @@ void fils(const char *fichier, int i, int vi) {
 
     CHK(kill(pid, SIGUSR2));
 
-    while (!recu2) {
-        attendre_signal(SIGUSR2);
-        recu2 = 0;
-    }
-    CHK(fd = open(fichier, O_RDONLY | O_CREAT, 0666));
-    CHK(lseek(fd, (i + 1) * sizeof(int), SEEK_SET));
+    attendre_signal(SIGUSR2);
+
+    // notre case contient maintenant la valeur du voisin précédent
+    CHK(fd = open(fichier, O_RDONLY));
+    CHK(lseek(fd, i * sizeof(int), SEEK_SET));
     CHK(read(fd, &val, sizeof(int)));
     printf("%d\n", val);
     CHK(close(fd));
     exit(0);
 }
 
-void lancer(const char *fichier, const int tv[], int n) {
+// taille de la projection : les cases puis les deux barrières
+size_t taille_partage(int n) {
+    return n * sizeof *cases + 2 * sizeof *barr;
+}
+
+void lancer(const char *fichier, const int tv[], int n, int partage,
+            struct timespec *debut) {
     int fd;
-    pid_t pid;
+    pid_t pid, pgid = 0;
     pid_t all_pid[n];
 
-    for (int i = 0; i <= n; ++i) {
-        switch (pid = fork()) {
+    if (partage) {
+        cases = mmap(NULL, taille_partage(n), PROT_READ | PROT_WRITE,
+                     MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+        if (cases == MAP_FAILED)
+            raler(1, "mmap");
+        if (demarrage == DEM_BARRIERE) {
+            // n fils + le père
+            barr = (struct barriere *)&cases[n];
+            for (int j = 0; j < 2; j++) {
+                barr[j].total = n + 1;
+                atomic_store(&barr[j].restants, n + 1);
+            }
+        }
+    }
+
+    for (int i = 0; i < n; ++i) {
+        switch (pid = lance_fork()) {
         case -1:
             raler(1, "fork");
         case 0:
-            fils(fichier, i, tv[i]);
+            // appel aussi fait par le père : peu importe qui passe en premier
+            if (demarrage == DEM_GROUPE)
+                CHK(setpgid(0, pgid));
+            fils(fichier, i, tv[i], n);
             exit(0);
         default:
             all_pid[i] = pid;
+            if (demarrage == DEM_GROUPE) {
+                if (pgid == 0)
+                    pgid = pid; // c0 est le chef du groupe
+                if (setpgid(pid, pgid) == -1 && errno != EACCES)
+                    raler(1, "setpgid %d", pid);
+            }
             break;
         }
     }
-    CHK(fd = open(fichier, O_RDWR | O_TRUNC | O_CREAT, 0666));
-    CHK(write(fd, all_pid, sizeof(all_pid)));
-    CHK(close(fd));
 
-    for (int i = 0; i <= n; ++i)
-        CHK(kill(all_pid[i], SIGUSR1));
+    if (!partage) {
+        CHK(fd = open(fichier, O_RDWR | O_TRUNC | O_CREAT, 0666));
+        CHK(write(fd, all_pid, sizeof(all_pid)));
+        CHK(close(fd));
+    }
+
+    CHK(clock_gettime(CLOCK_MONOTONIC, debut));
+
+    switch (demarrage) {
+    case DEM_KILL:
+        for (int i = 0; i < n; ++i)
+            CHK(kill(all_pid[i], SIGUSR1));
+        break;
+    case DEM_GROUPE:
+        CHK(kill(-pgid, SIGUSR1));
+        break;
+    case DEM_BARRIERE:
+        barriere_attendre(&barr[0]);
+        break;
+    }
 }
 
-int main(const int argc, const char *argv[]) {
-    int raison, n, pn;
+int main(int argc, const char *argv[]) {
+    int raison, n, pn, opt;
+    int partage = 0, chrono = 0;
+    const char *fich;
+    struct timespec debut, fin;
+
+    while ((opt = getopt(argc, (char *const *)argv, "+md:t")) != -1) {
+        switch (opt) {
+        case 'm':
+            partage = 1;
+            break;
+        case 'd':
+            if (strcmp(optarg, "kill") == 0)
+                demarrage = DEM_KILL;
+            else if (strcmp(optarg, "groupe") == 0)
+                demarrage = DEM_GROUPE;
+            else if (strcmp(optarg, "barriere") == 0) {
+                demarrage = DEM_BARRIERE;
+                partage = 1; // la barrière est dans la projection
+            } else
+                raler(0, USAGE);
+            break;
+        case 't':
+            chrono = 1;
+            break;
+        default:
+            raler(0, USAGE);
+        }
+    }
+    argc -= optind - 1;
+    argv += optind - 1;
+
     n = argc - 2;
-    pn = n;
+    pn = n > 0 ? n : 1;
     int tv[pn];
 
-    args(argc, argv, &argv[1], tv, &pn);
+    args(argc, argv, &fich, tv, &pn);
+
+    preparer_signaux();
+    lancer(fich, tv, n, partage, &debut);
 
-    for (int i = 0; i <= n; ++i) {
-        CHK(wait(&raison));
+    // fin du tour : barrière de fin, ou à défaut terminaison des fils
+    if (barr != NULL) {
+        barriere_attendre(&barr[1]);
+        CHK(clock_gettime(CLOCK_MONOTONIC, &fin));
+        // la mesure n'a de sens que si tous les échanges sont terminés
+        for (int i = 0; i < n; ++i)
+            if (atomic_load(&cases[i].etat) != PUBLIE)
+                raler(0, "barrière de fin franchie avant la case %d", i);
+    }
+
+    for (int i = 0; i < n; ++i) {
+        CHK(lance_attendre(&raison));
         if (!(WIFEXITED(raison) && WEXITSTATUS(raison) == 0)) {
             if (WIFEXITED(raison))
                 raler(0, "fils mal terminé exit %d", WEXITSTATUS(raison));
@@ -175,6 +373,16 @@ int main(const int argc, const char *argv[]) {
         }
     }
 
-    CHK(unlink(argv[1]));
+    if (barr == NULL)
+        CHK(clock_gettime(CLOCK_MONOTONIC, &fin));
+    if (chrono)
+        fprintf(stderr, "%d processus, tour en %.0f ns\n", n,
+                (fin.tv_sec - debut.tv_sec) * 1e9 +
+                    (fin.tv_nsec - debut.tv_nsec));
+
+    if (partage)
+        CHK(munmap(cases, taille_partage(n)));
+    else
+        CHK(unlink(fich));
     exit(0);
 }
\ No newline at end of file
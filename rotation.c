@@ -1,9 +1,12 @@
+#define _GNU_SOURCE // SEEK_DATA, SEEK_HOLE
+
 #include <errno.h>
 #include <fcntl.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdnoreturn.h>
 #include <string.h>
+#include <sys/stat.h>
 #include <unistd.h>
 
 // les constantes demandées par l'énoncé
@@ -30,13 +33,46 @@ noreturn void usage(void) {
     exit(1);
 }
 
+/*
+ * Recopie les octets [debut, fin[ de fd1 à partir de la position dest
+ * de fd2, sans lire ni écrire les trous : SEEK_DATA / SEEK_HOLE donnent
+ * les zones de données, et un trou du fichier original reste un trou
+ * (jamais écrit) dans le nouveau fichier, créé vide. Un système de
+ * fichiers sans cette notion renvoie tout le fichier comme données.
+ */
+void copier(int fd1, int fd2, off_t debut, off_t fin, off_t dest) {
+    char buf[MAXBUF];
+    off_t donnees, trou, pos;
+    ssize_t nlus;
+
+    for (pos = debut; pos < fin; pos = trou) {
+        if ((donnees = lseek(fd1, pos, SEEK_DATA)) == -1) {
+            if (errno == ENXIO) // plus que du trou jusqu'à la fin
+                break;
+            raler("lseek SEEK_DATA");
+        }
+        if (donnees >= fin)
+            break;
+        CHK(trou = lseek(fd1, donnees, SEEK_HOLE));
+        trou = MIN(trou, fin);
+
+        for (pos = donnees; pos < trou; pos += nlus) {
+            CHK(nlus = pread(fd1, buf, MIN((off_t)sizeof buf, trou - pos),
+                             pos));
+            if (nlus == 0) // fichier raccourci entre-temps
+                return;
+            CHK(pwrite(fd2, buf, nlus, dest + (pos - debut)));
+        }
+    }
+}
+
 // org = chemin du fichier original
 void rotation(int n, const char *org) {
     int fd1, fd2;
-    char buf[MAXBUF];
     char pathrot[CHEMIN_MAX + 1]; // +1 pour le '\0' de fin de chaîne
     int l;
-    ssize_t nlus;
+    struct stat st;
+    off_t k;
 
     CHK(l = snprintf(pathrot, sizeof pathrot, "%s%s", org, SUFFIXE));
     if (l >= (int)sizeof pathrot) {
@@ -46,23 +82,18 @@ void rotation(int n, const char *org) {
 
     CHK(fd1 = open(org, O_RDONLY));
     CHK(fd2 = open(pathrot, O_WRONLY | O_CREAT | O_TRUNC, 0666));
+    CHK(fstat(fd1, &st));
 
-    // étape 1 : recopier tous les octets à partir du n-ième
-    CHK(lseek(fd1, n, SEEK_SET));
-    while ((nlus = read(fd1, buf, sizeof buf)) > 0)
-        CHK(write(fd2, buf, nlus));
-    CHK(nlus);
+    // n >= taille : les n premiers octets sont tout le fichier, recopié
+    // tel quel
+    k = MIN((off_t)n, st.st_size);
 
+    // étape 1 : recopier tous les octets à partir du n-ième
+    copier(fd1, fd2, k, st.st_size, 0);
     // étape 2 : recopier les n premiers octets à la suite du nouveau fichier
-    CHK(lseek(fd1, 0, SEEK_SET));
-    while (n > 0) {
-        CHK(nlus = read(fd1, buf, MIN((int)sizeof buf, n)));
-        if (nlus == 0)
-            break;
-
-        CHK(write(fd2, buf, nlus));
-        n -= nlus;
-    }
+    copier(fd1, fd2, 0, k, st.st_size - k);
+    // un trou final n'a pas été écrit : fixer la taille
+    CHK(ftruncate(fd2, st.st_size));
 
     CHK(close(fd1));
     CHK(close(fd2));
@@ -1,26 +1,61 @@
+#define _GNU_SOURCE // MAP_ANONYMOUS, SIGRTMIN, timer_create, CPU_SET
+
 #include <dirent.h>
 #include <errno.h>
+#include <ctype.h>
 #include <fcntl.h>
+#include <inttypes.h>
+#include <linux/futex.h>
+#include <limits.h>
+#include <mqueue.h>
 #include <signal.h>
+#include <sched.h>
 #include <stdarg.h>
+#include <stdatomic.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdnoreturn.h>
 #include <string.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
 #include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/timerfd.h>
 #include <sys/types.h>
 #include <sys/wait.h>
+#include <time.h>
 #include <unistd.h>
 
 #define CHEMIN_MAX 128
 
+#define USAGE                                                                  \
+    "usage: sig nb-secondes\n"                                                 \
+    "       sig -q [-k k] [-i intervalle-us] [-s S] [-r R]\n"                  \
+    "              [-c meme|smt|socket|croise|cpu,...] nb-secondes\n"       \
+    "       sig -b [-m mecanisme,...] [-n iter] [-T octets]"
+
+#define TAILLE_MAX (1 << 20) // plus grande charge utile mesurée
+#define FENETRE 16           // messages envoyés par acquittement (débit)
+#define SEQ_MAX 4096         // taille au-delà de laquelle iter diminue
+#define MQ_PROF 8 // messages par file (fs.mqueue.msg_max vaut 10)
+#define LOT 64    // signaux lus par read sur le signalfd (-q)
+#define FIN_RT (UINT64_C(1) << 63) // marque de fin : nb émis | FIN_RT
+
 #define CHK(op)                                                                \
     do {                                                                       \
         if ((op) == -1)                                                        \
             raler(1, #op);                                                     \
     } while (0)
 
+#define CHKN(op)                                                               \
+    do {                                                                       \
+        if ((op) == NULL)                                                      \
+            raler(1, #op);                                                     \
+    } while (0)
+
 noreturn void raler(int syserr, const char *fmt, ...) {
     va_list ap;
     va_start(ap, fmt);
@@ -69,14 +104,935 @@ void child(void) {
     exit(0);
 }
 
+void attendre_fils(void) {
+    int raison;
+
+    CHK(wait(&raison));
+    if (!(WIFEXITED(raison) && WEXITSTATUS(raison) == 0)) {
+        if (WIFEXITED(raison))
+            raler(0, "fils mal terminé exit %d", WEXITSTATUS(raison));
+        else if (WIFSIGNALED(raison))
+            raler(0, "fils mal terminé signal %d", WTERMSIG(raison));
+        else
+            raler(0, "fils mal terminé raison inconnue");
+    }
+}
+
+/*
+ * Banc d'essai des IPC (-b) : pour chaque mécanisme et chaque taille de
+ * charge utile, un fils fait l'écho des messages du père.
+ * - latence : iter allers-retours, la latence d'un aller est la moitié
+ *   du temps d'un aller-retour ;
+ * - débit : iter messages par paquets de FENETRE, le fils acquitte
+ *   chaque paquet. Les signaux classiques fusionnent quand ils sont en
+ *   attente : ils sont envoyés un par un.
+ * Mécanismes :
+ * - signal : SIGUSR1 par kill, reçu par un gestionnaire et sigsuspend ;
+ * - sigqueue : signal temps réel, charge utile dans sigval (8 octets) ;
+ * - signalfd : idem, mais lu par read sur un signalfd ;
+ * - pipe, socket (socketpair AF_UNIX) : flot d'octets ;
+ * - eventfd : en mode sémaphore, pas de charge utile ;
+ * - mqueue : file de messages POSIX, taille limitée par le système ;
+ * - futex : une case en mémoire partagée, réveil par futex seulement si
+ *   le destinataire dort.
+ * Chaque mesure produit une ligne d'un tableau séparé par tabulations.
+ */
+enum meca {
+    M_SIGNAL,
+    M_SIGQUEUE,
+    M_SIGNALFD,
+    M_PIPE,
+    M_SOCKET,
+    M_EVENTFD,
+    M_MQUEUE,
+    M_FUTEX,
+    M_NB
+};
+
+const char *noms_meca[M_NB] = {"signal", "sigqueue", "signalfd", "pipe",
+                               "socket", "eventfd",  "mqueue",   "futex"};
+
+// charge utile maximale de chaque mécanisme
+const size_t max_meca[M_NB] = {0,          sizeof(union sigval),
+                               sizeof(union sigval), TAILLE_MAX,
+                               TAILLE_MAX, 0,
+                               TAILLE_MAX, TAILLE_MAX};
+
+const size_t tailles[] = {0, 8, 64, 512, 4096, 32768, 262144, TAILLE_MAX};
+
+// case d'échange du mécanisme futex, suivie des données
+struct zone {
+    _Alignas(64) atomic_uint depose; // nb de messages déposés
+    atomic_uint dort_rec;
+    _Alignas(64) atomic_uint retire; // nb de messages retirés
+    atomic_uint dort_env;
+    _Alignas(64) char data[];
+};
+
+// un sens de communication
+struct canal {
+    enum meca m;
+    int fd[2];     // pipe, socket, eventfd (fd[0]), signalfd (fd[0])
+    mqd_t mq;
+    struct zone *z;
+    size_t taille; // taille de la zone ou des messages de la file
+    int sig;       // signal porteur
+    pid_t dest;    // destinataire des signaux
+};
+
+long futex(atomic_uint *mot, int op, unsigned val) {
+    return syscall(SYS_futex, mot, op, val, NULL, NULL, 0);
+}
+
+// attend que *mot ne vaille plus v
+void attendre_mot(atomic_uint *mot, unsigned v, atomic_uint *dort) {
+    while (atomic_load(mot) == v) {
+        atomic_store(dort, 1);
+        if (futex(mot, FUTEX_WAIT, v) == -1 && errno != EAGAIN &&
+            errno != EINTR)
+            raler(1, "futex");
+        atomic_store(dort, 0);
+    }
+}
+
+void avancer_mot(atomic_uint *mot, atomic_uint *dort) {
+    atomic_fetch_add(mot, 1);
+    if (atomic_load(dort))
+        futex(mot, FUTEX_WAKE, 1);
+}
+
+// renvoie -1 si le mécanisme refuse cette taille (mqueue)
+int ouvrir(struct canal *c, enum meca m, size_t taille) {
+    struct mq_attr attr = {.mq_maxmsg = MQ_PROF,
+                           .mq_msgsize = taille > 0 ? taille : 1};
+    char nom[CHEMIN_MAX + 1];
+    sigset_t set;
+
+    c->m = m;
+    c->taille = taille;
+    c->sig = m == M_SIGNAL ? SIGUSR1 : SIGRTMIN;
+    switch (m) {
+    case M_SIGNAL:
+    case M_SIGQUEUE:
+        break;
+    case M_SIGNALFD:
+        CHK(sigemptyset(&set));
+        CHK(sigaddset(&set, c->sig));
+        CHK(c->fd[0] = signalfd(-1, &set, 0));
+        break;
+    case M_PIPE:
+        CHK(pipe(c->fd));
+        break;
+    case M_SOCKET:
+        CHK(socketpair(AF_UNIX, SOCK_STREAM, 0, c->fd));
+        break;
+    case M_EVENTFD:
+        CHK(c->fd[0] = eventfd(0, EFD_SEMAPHORE));
+        break;
+    case M_MQUEUE:
+        // le nom ne sert qu'à l'ouverture : le descripteur suffit ensuite
+        snprintf(nom, sizeof nom, "/sig.%d.%p", getpid(), (void *)c);
+        c->mq = mq_open(nom, O_RDWR | O_CREAT | O_EXCL, 0600, &attr);
+        if (c->mq == (mqd_t)-1) {
+            // au-delà de fs.mqueue.msgsize_max, ou files non disponibles
+            if (errno == EINVAL || errno == EMFILE || errno == ENOMEM ||
+                errno == ENOSYS)
+                return -1;
+            raler(1, "mq_open %s", nom);
+        }
+        CHK(mq_unlink(nom));
+        break;
+    case M_FUTEX:
+        c->z = mmap(NULL, sizeof *c->z + taille, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+        if (c->z == MAP_FAILED)
+            raler(1, "mmap");
+        break;
+    case M_NB:
+        break;
+    }
+    return 0;
+}
+
+void fermer(struct canal *c) {
+    switch (c->m) {
+    case M_PIPE:
+    case M_SOCKET:
+        // une seule extrémité reste ouverte après garder()
+        CHK(close(c->fd[c->fd[0] != -1 ? 0 : 1]));
+        break;
+    case M_SIGNALFD:
+    case M_EVENTFD:
+        CHK(close(c->fd[0]));
+        break;
+    case M_MQUEUE:
+        CHK(mq_close(c->mq));
+        break;
+    case M_FUTEX:
+        CHK(munmap(c->z, sizeof *c->z + c->taille));
+        break;
+    default:
+        break;
+    }
+}
+
+void ecrire_tout(int fd, const char *buf, size_t t) {
+    ssize_t n;
+
+    for (size_t fait = 0; fait < t; fait += n)
+        CHK(n = write(fd, buf + fait, t - fait));
+}
+
+void lire_tout(int fd, char *buf, size_t t) {
+    ssize_t n;
+
+    for (size_t fait = 0; fait < t; fait += n) {
+        CHK(n = read(fd, buf + fait, t - fait));
+        if (n == 0)
+            raler(0, "fin de fichier prématurée");
+    }
+}
+
+void envoyer(struct canal *c, const char *buf, size_t t) {
+    union sigval v = {0};
+    uint64_t un = 1;
+    struct zone *z = c->z;
+    unsigned d;
+
+    switch (c->m) {
+    case M_SIGNAL:
+        CHK(kill(c->dest, c->sig));
+        break;
+    case M_SIGQUEUE:
+    case M_SIGNALFD:
+        memcpy(&v, buf, t);
+        // la file des signaux temps réel peut être pleine
+        while (sigqueue(c->dest, c->sig, v) == -1)
+            if (errno != EAGAIN)
+                raler(1, "sigqueue");
+        break;
+    case M_PIPE:
+    case M_SOCKET:
+        // un message vide est tout de même un octet sur le flot
+        ecrire_tout(c->fd[1], t > 0 ? buf : "", t > 0 ? t : 1);
+        break;
+    case M_EVENTFD:
+        CHK(write(c->fd[0], &un, sizeof un));
+        break;
+    case M_MQUEUE:
+        CHK(mq_send(c->mq, buf, t, 0));
+        break;
+    case M_FUTEX:
+        // case unique : attendre que le message précédent soit retiré
+        d = atomic_load_explicit(&z->depose, memory_order_relaxed);
+        attendre_mot(&z->retire, d - 1, &z->dort_env);
+        memcpy(z->data, buf, t);
+        avancer_mot(&z->depose, &z->dort_rec);
+        break;
+    case M_NB:
+        break;
+    }
+}
+
+void recevoir(struct canal *c, char *buf, size_t t, const sigset_t *attente) {
+    struct signalfd_siginfo ssi;
+    siginfo_t info;
+    sigset_t set;
+    uint64_t val;
+    struct zone *z = c->z;
+    unsigned r;
+
+    switch (c->m) {
+    case M_SIGNAL:
+        while (s1_recu == 0)
+            sigsuspend(attente);
+        s1_recu = 0;
+        break;
+    case M_SIGQUEUE:
+        CHK(sigemptyset(&set));
+        CHK(sigaddset(&set, c->sig));
+        while (sigwaitinfo(&set, &info) == -1)
+            if (errno != EINTR)
+                raler(1, "sigwaitinfo");
+        memcpy(buf, &info.si_value, t);
+        break;
+    case M_SIGNALFD:
+        lire_tout(c->fd[0], (char *)&ssi, sizeof ssi);
+        memcpy(buf, &ssi.ssi_ptr, t);
+        break;
+    case M_PIPE:
+    case M_SOCKET:
+        if (t > 0)
+            lire_tout(c->fd[0], buf, t);
+        else
+            lire_tout(c->fd[0], (char *)&val, 1);
+        break;
+    case M_EVENTFD:
+        CHK(read(c->fd[0], &val, sizeof val));
+        break;
+    case M_MQUEUE:
+        if (mq_receive(c->mq, buf, c->taille > 0 ? c->taille : 1, NULL) !=
+            (ssize_t)t)
+            raler(1, "mq_receive");
+        break;
+    case M_FUTEX:
+        r = atomic_load_explicit(&z->retire, memory_order_relaxed);
+        attendre_mot(&z->depose, r, &z->dort_rec);
+        memcpy(buf, z->data, t);
+        avancer_mot(&z->retire, &z->dort_env);
+        break;
+    case M_NB:
+        break;
+    }
+}
+
+/*
+ * Flots : on écrit sur fd[1] et on lit sur fd[0] (un socketpair est
+ * bidirectionnel, mais chaque canal n'a qu'un sens). Le récepteur ne
+ * garde que fd[0], l'émetteur que fd[1].
+ */
+void garder(struct canal *c, int recepteur) {
+    int inutile = recepteur ? 1 : 0;
+
+    if (c->m == M_PIPE || c->m == M_SOCKET) {
+        CHK(close(c->fd[inutile]));
+        c->fd[inutile] = -1;
+    }
+}
+
+int iterations(int iter, size_t taille) {
+    long n = taille <= SEQ_MAX ? (long)iter : (long)(iter * SEQ_MAX / taille);
+    return n < 10 ? 10 : n;
+}
+
+double maintenant_ns(void) {
+    struct timespec ts;
+    CHK(clock_gettime(CLOCK_MONOTONIC, &ts));
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+void echo(struct canal *aller, struct canal *retour, char *buf, size_t taille,
+          int iter, int fenetre, const sigset_t *attente) {
+    for (int i = 0; i < iter; i++) {
+        recevoir(aller, buf, taille, attente);
+        envoyer(retour, buf, taille);
+    }
+    for (int i = 0; i < iter; i += fenetre) {
+        for (int j = i; j < iter && j < i + fenetre; j++)
+            recevoir(aller, buf, taille, attente);
+        envoyer(retour, buf, 0);
+    }
+}
+
+void mesurer(enum meca m, size_t taille, int iter, const sigset_t *attente) {
+    struct canal aller, retour;
+    int fenetre = m == M_SIGNAL ? 1 : FENETRE;
+    double debut, lat, deb;
+    char *buf;
+    pid_t pid;
+
+    if (ouvrir(&aller, m, taille) == -1)
+        return;
+    if (ouvrir(&retour, m, taille) == -1) {
+        fermer(&aller);
+        return;
+    }
+    iter = iterations(iter, taille);
+    CHKN(buf = malloc(taille > 0 ? taille : 1));
+    for (size_t i = 0; i < taille; i++)
+        buf[i] = i;
+
+    switch (pid = fork()) {
+    case -1:
+        raler(1, "fork");
+    case 0:
+        retour.dest = getppid();
+        garder(&aller, 1);
+        garder(&retour, 0);
+        echo(&aller, &retour, buf, taille, iter, fenetre, attente);
+        exit(0);
+    default:
+        aller.dest = pid;
+        garder(&aller, 0);
+        garder(&retour, 1);
+        break;
+    }
+
+    debut = maintenant_ns();
+    for (int i = 0; i < iter; i++) {
+        envoyer(&aller, buf, taille);
+        recevoir(&retour, buf, taille, attente);
+    }
+    lat = (maintenant_ns() - debut) / iter / 2;
+    for (size_t i = 0; i < taille; i++)
+        if (buf[i] != (char)i)
+            raler(0, "%s : charge utile altérée", noms_meca[m]);
+
+    debut = maintenant_ns();
+    for (int i = 0; i < iter; i += fenetre) {
+        for (int j = i; j < iter && j < i + fenetre; j++)
+            envoyer(&aller, buf, taille);
+        recevoir(&retour, buf, 0, attente);
+    }
+    deb = iter / ((maintenant_ns() - debut) / 1e9);
+
+    attendre_fils();
+    printf("%s\t%zu\t%d\t%.0f\t%.0f\t%.1f\n", noms_meca[m], taille, iter, lat,
+           deb, deb * taille / 1e6);
+    CHK(fflush(stdout) == EOF ? -1 : 0);
+
+    free(buf);
+    fermer(&aller);
+    fermer(&retour);
+}
+
+// "pipe,futex" : mécanismes retenus
+void choisir(const char *liste, int retenu[M_NB]) {
+    char copie[CHEMIN_MAX + 1], *mot, *ctx;
+    int m;
+
+    if (strlen(liste) > CHEMIN_MAX)
+        raler(0, USAGE);
+    strcpy(copie, liste);
+    for (m = 0; m < M_NB; m++)
+        retenu[m] = 0;
+    for (mot = strtok_r(copie, ",", &ctx); mot != NULL;
+         mot = strtok_r(NULL, ",", &ctx)) {
+        for (m = 0; m < M_NB && strcmp(mot, noms_meca[m]) != 0; m++)
+            ;
+        if (m == M_NB)
+            raler(0, "mécanisme inconnu : %s", mot);
+        retenu[m] = 1;
+    }
+}
+
+void banc(const int retenu[M_NB], int iter, size_t max) {
+    sigset_t bloques, attente;
+    struct sigaction s;
+
+    // les signaux ne sont reçus que dans sigsuspend, sigwaitinfo, signalfd
+    s.sa_flags = 0;
+    s.sa_handler = recv_sigusr1;
+    CHK(sigemptyset(&s.sa_mask));
+    CHK(sigaction(SIGUSR1, &s, NULL));
+    CHK(sigemptyset(&bloques));
+    CHK(sigaddset(&bloques, SIGUSR1));
+    CHK(sigaddset(&bloques, SIGRTMIN));
+    CHK(sigprocmask(SIG_BLOCK, &bloques, &attente));
+    CHK(sigdelset(&attente, SIGUSR1));
+
+    printf("mecanisme\toctets\titer\tlatence_ns\tmsg_s\tMo_s\n");
+    CHK(fflush(stdout) == EOF ? -1 : 0); // avant les fork
+    for (int m = 0; m < M_NB; m++) {
+        if (!retenu[m])
+            continue;
+        for (size_t i = 0; i < sizeof tailles / sizeof tailles[0]; i++)
+            if (tailles[i] <= max && tailles[i] <= max_meca[m])
+                mesurer(m, tailles[i], iter, &attente);
+    }
+}
+
+/*
+ * Histogramme à intervalles logarithmiques, à la manière de HdrHistogram :
+ * chaque puissance de 2 est découpée en 2^HIST_SOUS intervalles égaux,
+ * soit une erreur relative d'au plus 1/2^HIST_SOUS sur un quantile.
+ */
+#define HIST_SOUS 4
+#define HIST_NB (64 << HIST_SOUS)
+
+struct histo {
+    uint64_t nb[HIST_NB];
+    uint64_t total, max;
+};
+
+int hist_indice(uint64_t v) {
+    int e;
+
+    if (v < (1 << HIST_SOUS))
+        return v;
+    e = 63 - __builtin_clzll(v); // e >= HIST_SOUS
+    return ((e - HIST_SOUS + 1) << HIST_SOUS) +
+           ((v >> (e - HIST_SOUS)) & ((1 << HIST_SOUS) - 1));
+}
+
+// plus petite valeur de l'intervalle i
+uint64_t hist_borne(int i) {
+    int e, m;
+
+    if (i < (1 << HIST_SOUS))
+        return i;
+    e = (i >> HIST_SOUS) + HIST_SOUS - 1;
+    m = i & ((1 << HIST_SOUS) - 1);
+    return ((UINT64_C(1) << HIST_SOUS) + m) << (e - HIST_SOUS);
+}
+
+void hist_ajouter(struct histo *h, uint64_t v) {
+    h->nb[hist_indice(v)]++;
+    h->total++;
+    if (v > h->max)
+        h->max = v;
+}
+
+// borne supérieure de l'intervalle contenant le quantile q
+uint64_t hist_quantile(const struct histo *h, double q) {
+    uint64_t rang = q * h->total, cumul = 0;
+
+    for (int i = 0; i < HIST_NB - 1; i++) {
+        cumul += h->nb[i];
+        if (cumul > rang)
+            return hist_borne(i + 1) - 1 < h->max ? hist_borne(i + 1) - 1
+                                                  : h->max;
+    }
+    return h->max;
+}
+
+uint64_t horloge_brute(void) {
+    struct timespec ts;
+    CHK(clock_gettime(CLOCK_MONOTONIC_RAW, &ts));
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+// secondes (éventuellement fractionnaires, 0 <= secondes <= INT_MAX)
+struct timespec en_timespec(double secondes) {
+    struct timespec ts;
+
+    ts.tv_sec = secondes;
+    ts.tv_nsec = (secondes - ts.tv_sec) * 1e9;
+    return ts;
+}
+
+// SIGALRM au bout de secondes (éventuellement fractionnaires)
+void armer(double secondes) {
+    struct sigevent ev = {.sigev_notify = SIGEV_SIGNAL,
+                          .sigev_signo = SIGALRM};
+    struct itimerspec it = {0};
+    timer_t t;
+
+    it.it_value = en_timespec(secondes);
+    CHK(timer_create(CLOCK_MONOTONIC, &ev, &t));
+    CHK(timer_settime(t, 0, &it, NULL));
+}
+
+/*
+ * Comptage sans perte (-q) : les signaux classiques en attente fusionnent,
+ * si bien que le fils compte les fusions plutôt que les envois. Ici des
+ * émetteurs envoient SIGRTMIN+k par sigqueue, chacun à tour de rôle vers
+ * chaque récepteur, qui les lit par paquets sur un signalfd. La charge
+ * utile est l'instant d'envoi (CLOCK_MONOTONIC_RAW, commune à tous les
+ * processus) : le récepteur en déduit la latence de chaque signal,
+ * rangée dans un histogramme. À la fin, chaque émetteur envoie à chaque
+ * récepteur un dernier signal portant le nombre d'envois réussis vers
+ * lui : la file des signaux temps réel étant FIFO, il arrive après les
+ * autres.
+ * - refusés : sigqueue en échec (EAGAIN), file du destinataire pleine ;
+ * - fusionnés : envoyés mais jamais reçus (nul pour un signal temps réel) ;
+ * - hors ordre : instant d'envoi antérieur au précédent du même émetteur.
+ * Sans -i, les émetteurs envoient au plus vite et la latence inclut
+ * l'attente dans la file ; avec -i, un envoi par période d'un timerfd.
+ *
+ * Avec -s S -r R et -c, on observe le coût de la contention sur le verrou
+ * des signaux du destinataire et des interruptions inter-processeurs. Le
+ * père ne fait que coordonner ; les bilans reviennent par mémoire
+ * partagée.
+ */
+struct bilan_rec {
+    struct histo h;
+    uint64_t recus, emis, hors_ordre;
+    double debut, fin; // premier et dernier signal (CLOCK_MONOTONIC)
+    int cpu;
+};
+
+struct bilan_env {
+    uint64_t emis, refuses;
+    int cpu;
+};
+
+struct rt {
+    atomic_uint depart; // mot futex : 1 quand tous les pid sont connus
+    atomic_int arret;
+    int sig, nenv, nrec;
+    long intervalle_us;
+    pid_t *pid_env, *pid_rec;
+    struct bilan_env *env;
+    struct bilan_rec *rec;
+};
+
+// placement (-c) : processeurs des émetteurs puis des récepteurs
+struct placement {
+    int env[CPU_SETSIZE], nenv;
+    int rec[CPU_SETSIZE], nrec;
+};
+
+void *partager(size_t taille) {
+    void *p = mmap(NULL, taille, PROT_READ | PROT_WRITE,
+                   MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED)
+        raler(1, "mmap");
+    return p;
+}
+
+void attendre_depart(struct rt *rt) {
+    while (atomic_load(&rt->depart) == 0)
+        if (futex(&rt->depart, FUTEX_WAIT, 0) == -1 && errno != EAGAIN &&
+            errno != EINTR)
+            raler(1, "futex");
+}
+
+void epingler(const int cpus[], int n, int i) {
+    cpu_set_t set;
+
+    if (n == 0)
+        return;
+    CPU_ZERO(&set);
+    CPU_SET(cpus[i % n], &set);
+    CHK(sched_setaffinity(0, sizeof set, &set));
+}
+
+noreturn void recepteur(struct rt *rt, int moi) {
+    struct signalfd_siginfo lot[LOT];
+    struct bilan_rec *b = &rt->rec[moi];
+    uint64_t dernier[rt->nenv], t;
+    int fins = 0, e;
+    sigset_t set;
+    ssize_t lu;
+    int sfd;
+
+    CHK(sigemptyset(&set));
+    CHK(sigaddset(&set, rt->sig));
+    CHK(sfd = signalfd(-1, &set, 0));
+    for (e = 0; e < rt->nenv; e++)
+        dernier[e] = 0;
+    b->cpu = sched_getcpu();
+    attendre_depart(rt); // pid des émetteurs connus
+
+    while (fins < rt->nenv) {
+        CHK(lu = read(sfd, lot, sizeof lot));
+        t = horloge_brute();
+        if (b->recus == 0)
+            b->debut = maintenant_ns();
+        for (ssize_t i = 0; i < lu / (ssize_t)sizeof lot[0]; i++) {
+            for (e = 0; e < rt->nenv && rt->pid_env[e] != (pid_t)lot[i].ssi_pid;
+                 e++)
+                ;
+            if (e == rt->nenv)
+                raler(0, "signal d'un émetteur inconnu %d", lot[i].ssi_pid);
+            if (lot[i].ssi_ptr & FIN_RT) {
+                b->emis += lot[i].ssi_ptr & ~FIN_RT;
+                fins++;
+            } else {
+                if (lot[i].ssi_ptr < dernier[e])
+                    b->hors_ordre++;
+                dernier[e] = lot[i].ssi_ptr;
+                hist_ajouter(&b->h, t - dernier[e]);
+                b->recus++;
+            }
+        }
+    }
+    b->fin = maintenant_ns();
+    exit(0);
+}
+
+noreturn void emetteur(struct rt *rt, int moi) {
+    struct bilan_env *b = &rt->env[moi];
+    uint64_t emis[rt->nrec], ticks;
+    struct itimerspec it = {0};
+    union sigval v;
+    int tfd = -1, r;
+
+    for (r = 0; r < rt->nrec; r++)
+        emis[r] = 0;
+    if (rt->intervalle_us > 0) {
+        CHK(tfd = timerfd_create(CLOCK_MONOTONIC, 0));
+        it.it_interval.tv_sec = rt->intervalle_us / 1000000;
+        it.it_interval.tv_nsec = rt->intervalle_us % 1000000 * 1000;
+        it.it_value = it.it_interval;
+    }
+    b->cpu = sched_getcpu();
+    attendre_depart(rt);
+    if (tfd != -1)
+        CHK(timerfd_settime(tfd, 0, &it, NULL));
+
+    // chaque émetteur commence par un récepteur différent
+    r = moi % rt->nrec;
+    while (!atomic_load_explicit(&rt->arret, memory_order_relaxed)) {
+        if (tfd != -1)
+            CHK(read(tfd, &ticks, sizeof ticks));
+        v.sival_ptr = (void *)(uintptr_t)horloge_brute();
+        if (sigqueue(rt->pid_rec[r], rt->sig, v) == 0) {
+            b->emis++;
+            emis[r]++;
+        } else if (errno == EAGAIN) {
+            b->refuses++;
+        } else {
+            raler(1, "sigqueue");
+        }
+        r = (r + 1) % rt->nrec;
+    }
+
+    for (r = 0; r < rt->nrec; r++) {
+        v.sival_ptr = (void *)(uintptr_t)(emis[r] | FIN_RT);
+        while (sigqueue(rt->pid_rec[r], rt->sig, v) == -1)
+            if (errno != EAGAIN)
+                raler(1, "sigqueue");
+    }
+    exit(0);
+}
+
+int lire_topologie(int cpu, const char *quoi) {
+    char chemin[CHEMIN_MAX + 1];
+    FILE *f;
+    int v;
+
+    snprintf(chemin, sizeof chemin,
+             "/sys/devices/system/cpu/cpu%d/topology/%s", cpu, quoi);
+    CHKN(f = fopen(chemin, "r"));
+    if (fscanf(f, "%d", &v) != 1)
+        raler(0, "%s illisible", chemin);
+    CHK(fclose(f) == EOF ? -1 : 0);
+    return v;
+}
+
+/*
+ * Placement relatif au premier processeur autorisé c0 : les émetteurs
+ * sont sur c0, les récepteurs sur c0 (meme), sur un autre fil matériel
+ * du même cœur (smt), sur un autre cœur du même boîtier (socket) ou sur
+ * un autre boîtier (croise). Une liste "0,2,5,7" est partagée : sa
+ * première moitié (arrondie au-dessus) pour les émetteurs, le reste pour
+ * les récepteurs, chaque groupe étant placé tour à tour sur les siens.
+ * Un processeur seul reçoit tout le monde.
+ */
+void placer(const char *mode, struct placement *pl) {
+    cpu_set_t permis;
+    int c0 = -1, boitier0 = 0, coeur0 = 0, boitier, coeur, meme;
+    char copie[CHEMIN_MAX + 1], *mot, *ctx;
+    int liste[CPU_SETSIZE], n = 0;
+
+    pl->nenv = pl->nrec = 0;
+    if (mode == NULL)
+        return;
+
+    if (isdigit((unsigned char)mode[0])) {
+        if (strlen(mode) > CHEMIN_MAX)
+            raler(0, USAGE);
+        strcpy(copie, mode);
+        for (mot = strtok_r(copie, ",", &ctx); mot != NULL;
+             mot = strtok_r(NULL, ",", &ctx))
+            if ((liste[n++] = atoi(mot)) >= CPU_SETSIZE)
+                raler(0, "processeur %s invalide", mot);
+        for (int i = 0; i < n; i++) {
+            if (n == 1 || i < (n + 1) / 2)
+                pl->env[pl->nenv++] = liste[i];
+            if (n == 1 || i >= (n + 1) / 2)
+                pl->rec[pl->nrec++] = liste[i];
+        }
+        return;
+    }
+
+    CHK(sched_getaffinity(0, sizeof permis, &permis));
+    for (int c = 0; c < CPU_SETSIZE; c++) {
+        if (!CPU_ISSET(c, &permis))
+            continue;
+        boitier = lire_topologie(c, "physical_package_id");
+        coeur = lire_topologie(c, "core_id");
+        if (c0 == -1) {
+            c0 = c;
+            boitier0 = boitier;
+            coeur0 = coeur;
+            pl->env[pl->nenv++] = c;
+            if (strcmp(mode, "meme") == 0)
+                pl->rec[pl->nrec++] = c;
+            continue;
+        }
+        meme = boitier == boitier0 && coeur == coeur0;
+        if ((strcmp(mode, "smt") == 0 && meme) ||
+            (strcmp(mode, "socket") == 0 && boitier == boitier0 && !meme) ||
+            (strcmp(mode, "croise") == 0 && boitier != boitier0))
+            pl->rec[pl->nrec++] = c;
+    }
+
+    if (strcmp(mode, "meme") != 0 && strcmp(mode, "smt") != 0 &&
+        strcmp(mode, "socket") != 0 && strcmp(mode, "croise") != 0)
+        raler(0, "placement inconnu : %s", mode);
+    if (pl->nrec == 0)
+        raler(0, "placement %s impossible sur cette machine", mode);
+}
+
+void comptage(double nb_sec, int k, long intervalle_us, int nenv, int nrec,
+              const char *mode) {
+    struct placement pl;
+    struct histo total = {0};
+    struct timespec duree;
+    uint64_t emis = 0, refuses = 0, recus = 0, annonces = 0, hors_ordre = 0;
+    double debut = 0, fin = 0;
+    struct rt *rt;
+    sigset_t set;
+    pid_t pid;
+
+    placer(mode, &pl);
+    rt = partager(sizeof *rt);
+    rt->sig = SIGRTMIN + k;
+    rt->nenv = nenv;
+    rt->nrec = nrec;
+    rt->intervalle_us = intervalle_us;
+    rt->pid_env = partager(nenv * sizeof(pid_t));
+    rt->pid_rec = partager(nrec * sizeof(pid_t));
+    rt->env = partager(nenv * sizeof *rt->env);
+    rt->rec = partager(nrec * sizeof *rt->rec);
+    if (rt->sig > SIGRTMAX)
+        raler(0, "SIGRTMIN+%d au-delà de SIGRTMAX", k);
+
+    // bloqué avant les fork : rien n'est perdu avant la lecture
+    CHK(sigemptyset(&set));
+    CHK(sigaddset(&set, rt->sig));
+    CHK(sigprocmask(SIG_BLOCK, &set, NULL));
+
+    for (int i = 0; i < nrec + nenv; i++) {
+        switch (pid = fork()) {
+        case -1:
+            raler(1, "fork");
+        case 0:
+            if (i < nrec) {
+                epingler(pl.rec, pl.nrec, i);
+                recepteur(rt, i);
+            }
+            epingler(pl.env, pl.nenv, i - nrec);
+            emetteur(rt, i - nrec);
+        default:
+            if (i < nrec)
+                rt->pid_rec[i] = pid;
+            else
+                rt->pid_env[i - nrec] = pid;
+            break;
+        }
+    }
+
+    atomic_store(&rt->depart, 1);
+    futex(&rt->depart, FUTEX_WAKE, INT_MAX);
+    duree = en_timespec(nb_sec);
+    while (nanosleep(&duree, &duree) == -1)
+        if (errno != EINTR)
+            raler(1, "nanosleep");
+    atomic_store(&rt->arret, 1);
+
+    for (int i = 0; i < nrec + nenv; i++)
+        attendre_fils();
+
+    for (int e = 0; e < nenv; e++) {
+        emis += rt->env[e].emis;
+        refuses += rt->env[e].refuses;
+    }
+    printf("émetteurs : %d, émis = %" PRIu64 ", refusés = %" PRIu64 "\n",
+           nenv, emis, refuses);
+
+    for (int r = 0; r < nrec; r++) {
+        struct bilan_rec *b = &rt->rec[r];
+        printf("récepteur %d (cpu %d) : reçus = %" PRIu64 ", %.0f signaux/s\n",
+               r, b->cpu, b->recus,
+               b->recus > 1 ? b->recus / ((b->fin - b->debut) / 1e9) : 0);
+        recus += b->recus;
+        annonces += b->emis;
+        hors_ordre += b->hors_ordre;
+        if (b->recus > 0 && (debut == 0 || b->debut < debut))
+            debut = b->debut;
+        if (b->fin > fin)
+            fin = b->fin;
+        for (int i = 0; i < HIST_NB; i++)
+            total.nb[i] += b->h.nb[i];
+        total.total += b->h.total;
+        if (b->h.max > total.max)
+            total.max = b->h.max;
+    }
+    printf("récepteurs : %d, reçus = %" PRIu64 ", fusionnés = %" PRIu64
+           ", hors ordre = %" PRIu64 ", %.0f signaux/s\n",
+           nrec, recus, annonces - recus, hors_ordre,
+           recus > 1 ? recus / ((fin - debut) / 1e9) : 0);
+    if (recus > 0)
+        printf("latence (ns) p50 = %" PRIu64 ", p99 = %" PRIu64
+               ", p99.9 = %" PRIu64 ", max = %" PRIu64 "\n",
+               hist_quantile(&total, 0.5), hist_quantile(&total, 0.99),
+               hist_quantile(&total, 0.999), total.max);
+
+    CHK(munmap(rt->pid_env, nenv * sizeof(pid_t)));
+    CHK(munmap(rt->pid_rec, nrec * sizeof(pid_t)));
+    CHK(munmap(rt->env, nenv * sizeof *rt->env));
+    CHK(munmap(rt->rec, nrec * sizeof *rt->rec));
+    CHK(munmap(rt, sizeof *rt));
+}
+
 int main(int argc, char *argv[]) {
-    int raison, pid, nb_sec, nb_sent = 0;
+    int pid, nb_sent = 0;
+    double nb_sec;
+    struct timespec duree;
+    long intervalle = 0;
+    int nenv = 1, nrec = 1;
+    const char *mode = NULL;
+    char *fin;
+    int opt, bench = 0, rt = 0, k = 0, iter = 1000, retenu[M_NB];
+    long max = TAILLE_MAX;
     struct sigaction s;
 
+    for (int m = 0; m < M_NB; m++)
+        retenu[m] = 1;
+    while ((opt = getopt(argc, argv, "bm:n:T:qk:i:s:r:c:")) != -1) {
+        switch (opt) {
+        case 'b':
+            bench = 1;
+            break;
+        case 'm':
+            choisir(optarg, retenu);
+            break;
+        case 'n':
+            iter = atoi(optarg);
+            break;
+        case 'T':
+            max = atol(optarg);
+            break;
+        case 'q':
+            rt = 1;
+            break;
+        case 's':
+            if ((nenv = atoi(optarg)) <= 0)
+                raler(0, USAGE);
+            break;
+        case 'r':
+            if ((nrec = atoi(optarg)) <= 0)
+                raler(0, USAGE);
+            break;
+        case 'c':
+            mode = optarg;
+            break;
+        case 'i':
+            intervalle = atol(optarg);
+            if (intervalle < 0)
+                raler(0, USAGE);
+            break;
+        case 'k':
+            k = atoi(optarg);
+            if (k < 0)
+                raler(0, USAGE);
+            break;
+        default:
+            raler(0, USAGE);
+        }
+    }
+    if (bench) {
+        if (optind != argc || iter <= 0 || max < 0 || max > TAILLE_MAX)
+            raler(0, USAGE);
+        banc(retenu, iter, max);
+        exit(0);
+    }
+    argc -= optind - 1;
+    argv += optind - 1;
+
     if (argc < 2)
         raler(0, "usage sig nb-seconds");
-    nb_sec = atoi(argv[1]);
-    if (nb_sec < 0)
+    // fractions de seconde acceptées : "0.25", mais ni nan ni inf, et
+    // pas de durée convertie nulle : un itimerspec nul désarme le timer
+    nb_sec = strtod(argv[1], &fin);
+    if (*fin != '\0' || fin == argv[1] || !(nb_sec >= 0 && nb_sec <= INT_MAX))
+        raler(0, "usage sig nb-seconds");
+    duree = en_timespec(nb_sec);
+    if (duree.tv_sec == 0 && duree.tv_nsec == 0)
         raler(0, "usage sig nb-seconds");
 
     s.sa_flags = 0;
@@ -85,6 +1041,11 @@ int main(int argc, char *argv[]) {
     s.sa_handler = recv_alarm;
     CHK(sigaction(SIGALRM, &s, NULL));
 
+    if (rt) {
+        comptage(nb_sec, k, intervalle, nenv, nrec, mode);
+        exit(0);
+    }
+
     s.sa_handler = recv_sigusr1;
     CHK(sigaction(SIGUSR1, &s, NULL));
 
@@ -103,7 +1064,7 @@ int main(int argc, char *argv[]) {
         break;
     }
 
-    alarm(nb_sec);
+    armer(nb_sec);
     while (!alarm_recu) {
         CHK(kill(pid, SIGUSR1));
         nb_sent++;
@@ -113,15 +1074,7 @@ int main(int argc, char *argv[]) {
 
     CHK(kill(pid, SIGUSR2));
 
-    CHK(wait(&raison));
-    if (!(WIFEXITED(raison) && WEXITSTATUS(raison) == 0)) {
-        if (WIFEXITED(raison))
-            raler(0, "fils mal terminé exit %d", WEXITSTATUS(raison));
-        else if (WIFSIGNALED(raison))
-            raler(0, "fils mal terminé signal %d", WTERMSIG(raison));
-        else
-            raler(0, "fils mal terminé raison inconnue");
-    }
+    attendre_fils();
 
     exit(0);
-}
\ No newline at end of file
+}
@@ -367,6 +367,29 @@ verifier_pas_de_sortie $TMP
 cmp $TMP.src $TMP.src.rot.rot		|| fail "$TMP.src != $TMP.src.rot.rot"
 echo OK
 
+annoncer_test 4.4 "fichier creux"
+nettoyer
+# données, trou de 8 Mio, données, trou final de 8 Mio
+dd if=/dev/random bs=1000 count=1 > $TMP.src 2> /dev/null || fail "pb dd 1"
+dd if=/dev/random bs=1000 count=1 seek=8389 of=$TMP.src conv=notrunc \
+    2> /dev/null || fail "pb dd 2"
+truncate -s 16M $TMP.src || fail "pb truncate"
+# n au milieu des premières données, puis au milieu du premier trou
+for n in 500 4000000
+do
+    rm -f $TMP.src.rot
+    $PROG $n $TMP.src > $TMP.out 2> $TMP.err || fail "erreur rencontrée (n=$n)"
+    verifier_pas_de_sortie $TMP
+    reproduire_et_comparer $n $TMP.src
+    # si le système de fichiers gère les trous, le résultat reste creux
+    if [ $(du -k $TMP.src | cut -f1) -lt 1024 ]
+    then
+	[ $(du -k $TMP.src.rot | cut -f1) -lt 1024 ] \
+	    || fail "$TMP.src.rot n'est plus creux (n=$n)"
+    fi
+done
+echo OK
+
 ##############################################################################
 # Tests avec valgrind
 
@@ -203,6 +203,39 @@ creer_arbo ()
     creer_fichier $racine/d3/d31/e 3407
 }
 
+# Crée une arborescence large et profonde pour les parcours parallèles
+# $1 = racine
+creer_large_arbo ()
+{
+    [ $# != 1 ] && fail "ERREUR SYNTAXE creer_large_arbo"
+    local racine="$1"
+    local d f
+
+    for d in 1 2 3 4 5 6 7 8
+    do
+	mkdir -p $racine/r$d/s/t
+	for f in 1 2 3 4 5
+	do
+	    creer_fichier $racine/r$d/f$f $((d * 100 + f))
+	    creer_fichier $racine/r$d/s/t/g$f $((f * 37))
+	done
+    done
+}
+
+# Vérifie que deux sorties contiennent les mêmes lignes, à l'ordre près
+# $1 = sortie de référence
+# $2 = sortie à vérifier
+comparer_tri ()
+{
+    [ $# != 2 ] && fail "ERREUR SYNTAXE comparer_tri"
+    local ref="$1" out="$2"
+
+    sort "$ref" > "$ref.tri"
+    sort "$out" > "$out.tri"
+    diff "$ref.tri" "$out.tri" > "$out.diff" \
+	|| fail "$out != $ref à l'ordre près (cf $out.diff)"
+}
+
 # Supprimer les fichiers restant d'une précédente exécution
 nettoyer ()
 {
@@ -309,6 +342,123 @@ $PROG $TMP.d > $TMP.out 2> $TMP.err || fail "code de retour devrait être nul"
 [ $(wc -l < $TMP.out) != 5 ] && fail "nombre de fichiers incorrect"
 echo OK
 
+annoncer_test 2.5 "nb de threads invalide"
+nettoyer
+mkdir $TMP.d
+$PROG -j 0 $TMP.d > $TMP.out 2> $TMP.err && fail "-j 0"
+verifier_usage $TMP.err
+echo OK
+
+annoncer_test 2.6 "parcours en largeur (-l) et en parallèle (-j)"
+nettoyer
+creer_large_arbo $TMP.d
+$PROG $TMP.d > $TMP.ref 2> $TMP.err || fail "code de retour != 0"
+reproduire_et_comparer $TMP.ref $TMP.d
+for opt in -l "-j 2" "-j 8" "-l -j 3"
+do
+    $PROG $opt $TMP.d > $TMP.out 2> $TMP.err \
+	|| fail "code de retour != 0 ($opt)"
+    est_vide $TMP.err || fail "rien ne devrait être affiché sur stderr ($opt)"
+    comparer_tri $TMP.ref $TMP.out
+done
+echo OK
+
+annoncer_test 2.7 "empreinte CRC32C (-c)"
+nettoyer
+creer_arbo $TMP.d
+printf 123456789 > $TMP.d/d1/neuf
+: > $TMP.d/d2/vide
+$PROG $TMP.d > $TMP.ref 2> $TMP.err || fail "code de retour != 0"
+$PROG -c $TMP.d > $TMP.out 2> $TMP.err || fail "code de retour != 0 (-c)"
+# valeurs de contrôle de CRC32C (Castagnoli)
+grep -q " e3069283 $TMP.d/d1/neuf\$" $TMP.out || fail "CRC32C de 123456789 faux"
+grep -q " 00000000 $TMP.d/d2/vide\$" $TMP.out || fail "CRC32C du vide faux"
+# les autres colonnes sont inchangées
+cut -d' ' -f1-4,6- $TMP.out > $TMP.sans
+diff $TMP.ref $TMP.sans > $TMP.diff || fail "colonnes modifiées par -c"
+echo OK
+
+annoncer_test 2.8 "recherche des doublons (-d)"
+nettoyer
+creer_arbo $TMP.d
+cp $TMP.d/d1/d11/a $TMP.d/d2/a1
+cp $TMP.d/d1/d11/a $TMP.d/d3/a2
+cp $TMP.d/d1/d12/c $TMP.d/c1
+# même taille que b, contenu différent : pas un doublon
+creer_fichier $TMP.d/d2/b1 8117
+$PROG -d $TMP.d > $TMP.out 2> $TMP.err || fail "code de retour != 0"
+est_vide $TMP.err || fail "rien ne devrait être affiché sur stderr"
+# deux groupes séparés par une ligne vide : a (3 fichiers) et c (2)
+[ $(grep -c . $TMP.out) = 5 ] || fail "mauvais nombre de doublons"
+[ $(grep -c '^$' $TMP.out) = 1 ] || fail "mauvais nombre de groupes"
+grep -q "/b1\$" $TMP.out && fail "b1 n'est pas un doublon"
+for f in d1/d11/a d2/a1 d3/a2
+do
+    grep -q " 16383 $TMP.d/$f\$" $TMP.out || fail "$f absent du groupe de a"
+done
+echo OK
+
+annoncer_test 2.9 "inodes à plusieurs liens lus une fois (-u)"
+nettoyer
+creer_large_arbo $TMP.d
+ln $TMP.d/r1/f1 $TMP.d/r2/lien1
+ln $TMP.d/r1/f1 $TMP.d/r3/s/lien2
+ln $TMP.d/r4/f2 $TMP.d/r5/lien3
+$PROG $TMP.d > $TMP.ref 2> $TMP.err || fail "code de retour != 0"
+$PROG -u $TMP.d > $TMP.out 2> $TMP.err || fail "code de retour != 0 (-u)"
+[ $(wc -l < $TMP.out) = $(($(wc -l < $TMP.ref) - 3)) ] \
+    || fail "chaque inode devrait apparaître une seule fois"
+ino=$(ls -i $TMP.d/r1/f1 | cut -d' ' -f1)
+[ $(grep -c "^$ino 3 " $TMP.out) = 1 ] || fail "nb de liens de f1 != 3"
+ino=$(ls -i $TMP.d/r4/f2 | cut -d' ' -f1)
+[ $(grep -c "^$ino 2 " $TMP.out) = 1 ] || fail "nb de liens de f2 != 2"
+# sans la colonne des liens, chaque ligne est celle du mode par défaut
+cut -d' ' -f1,3- $TMP.out | sort > $TMP.sans
+sort $TMP.ref | comm -13 - $TMP.sans > $TMP.diff
+est_vide $TMP.diff || fail "lignes modifiées par -u (cf $TMP.diff)"
+# le chemin affiché pour un inode est celui du premier lien rencontré,
+# qui dépend de l'ordre de parcours : on ne compare que les inodes
+cut -d' ' -f1-5 $TMP.out > $TMP.ino
+for opt in --unique-inodes "-u -j 4" "-u -l -j 2"
+do
+    $PROG $opt $TMP.d > $TMP.par 2> $TMP.err \
+	|| fail "code de retour != 0 ($opt)"
+    cut -d' ' -f1-5 $TMP.par > $TMP.par.ino
+    comparer_tri $TMP.ino $TMP.par.ino
+done
+echo OK
+
+annoncer_test 2.10 "lettres Unicode et séquences invalides (-U)"
+nettoyer
+mkdir $TMP.d
+# h é l l o   w ö r l d, α β γ, я, 中 文, chiffres : 16 lettres
+printf 'h\303\251llo w\303\266rld\n\316\261\316\262\316\263 \321\217 \344\270\255\346\226\207 0123\n' \
+    > $TMP.d/valide
+# 0xff, 0xfe, forme trop longue (c0 af), surrogate (ed a0 80),
+# séquence tronquée (e2 82) : 8 invalides en comptant chaque partie
+# maximale mal formée à part, comme le recommande Unicode ; 2 lettres
+printf 'a\377\376\300\257\355\240\200b\342\202\n' > $TMP.d/invalide
+# 'é' à cheval sur les limites des lectures
+( printf x ; i=0 ; while [ $i -lt 1000 ] ; do printf '%0100d' 0 ; i=$((i+1)) ; done \
+    | sed 's/0/\xc3\xa9/g' ) > $TMP.d/long
+creer_fichier $TMP.d/ascii 3000
+LC_ALL=C tr -c -d 'a-zA-Z\n ' < $TMP.d/ascii > $TMP.d/texte
+$PROG -U $TMP.d > $TMP.out 2> $TMP.err || fail "code de retour != 0"
+est_vide $TMP.err || fail "rien ne devrait être affiché sur stderr"
+grep -q " 2 16 0 $TMP.d/valide\$" $TMP.out || fail "lettres Unicode mal comptées"
+grep -q " 1 2 8 $TMP.d/invalide\$" $TMP.out || fail "invalides mal comptés"
+grep -q " 0 100001 0 $TMP.d/long\$" $TMP.out \
+    || fail "séquences coupées entre deux lectures"
+# en ASCII, mêmes lettres que le mode par défaut et aucun invalide
+$PROG $TMP.d > $TMP.ref 2> $TMP.err || fail "code de retour != 0"
+grep " $TMP.d/texte\$" $TMP.ref | sed "s: $TMP.d/texte: 0 $TMP.d/texte:" \
+    > $TMP.att
+grep " $TMP.d/texte\$" $TMP.out | diff $TMP.att - > $TMP.diff \
+    || fail "texte ASCII compté différemment (cf $TMP.diff)"
+$PROG --utf8 -j 3 $TMP.d > $TMP.par 2> $TMP.err || fail "code de retour != 0"
+comparer_tri $TMP.out $TMP.par
+echo OK
+
 ##############################################################################
 # Cas aux limites
 
@@ -203,6 +203,32 @@ reproduire_et_comparer ()
     diff -r "$dst" "$att" > "$diff" || fail "$dst != $att, cf $diff"
 }
 
+# compare la destination d'un mode mise à jour, sans son manifeste
+# $1 = répertoire source
+# $2 = répertoire destination
+comparer_maj ()
+{
+    [ $# != 2 ] && fail "ERREUR SYNTAXE comparer_maj"
+    local src="$1" dst="$2"
+
+    [ -f "$dst/.majus" ] || fail "manifeste $dst/.majus absent"
+    rm -rf "$dst.c" "$dst.c.att"
+    cp -R "$dst" "$dst.c"
+    rm "$dst.c/.majus"
+    reproduire_et_comparer "$src" "$dst.c"
+}
+
+# vérifie le bilan affiché par le mode mise à jour
+# $1 = fichier de sortie, $2 = convertis, $3 = inchangés, $4 = supprimés
+verifier_bilan ()
+{
+    [ $# != 4 ] && fail "ERREUR SYNTAXE verifier_bilan"
+    local out="$1" att="$2 convertis, $3 inchangés, $4 supprimés"
+
+    [ x"$(cat $out)" = x"$att" ] \
+	|| fail "bilan '$(cat $out)' au lieu de '$att'"
+}
+
 # vérifie les permissions sur un fichier ou un répertoire
 # $1 = permissions (au format "rwxrwxrwx")
 # $2 = fichier ou répertoire
@@ -422,6 +448,144 @@ verifier_permissions rwxrwxrwx $TMP.s/d1
 verifier_permissions rwx-w---x $TMP.s/d1/d11
 echo OK
 
+annoncer_test 2.8 "mécanismes de lancement (LANCEMENT)"
+for l in fork vfork spawn clone pool
+do
+    nettoyer
+    creer_grande_arbo $TMP.s
+    LANCEMENT=$l $PROG $TMP.s $TMP.d > $TMP.out 2> $TMP.err \
+	|| fail "code de retour != 0 (LANCEMENT=$l)"
+    verifier_pas_de_sortie $TMP
+    reproduire_et_comparer $TMP.s $TMP.d
+done
+nettoyer
+creer_petite_arbo $TMP.s
+LANCEMENT=inconnu $PROG $TMP.s $TMP.d > $TMP.out 2> $TMP.err \
+    && fail "LANCEMENT=inconnu accepté"
+verifier_stderr $TMP "LANCEMENT=inconnu"
+echo OK
+
+annoncer_test 2.9 "mise à jour (-u)"
+nettoyer
+$PROG -c $TMP.s $TMP.d > $TMP.out 2> $TMP.err && fail "-c sans -u accepté"
+verifier_usage $TMP.err
+creer_grande_arbo $TMP.s
+nfic=$(find $TMP.s -type f -print | wc -l)
+$PROG -u $TMP.s $TMP.d > $TMP.out 2> $TMP.err \
+    || fail "code de retour != 0 (première passe)"
+verifier_stdout $TMP "première passe"
+verifier_bilan $TMP.out $nfic 0 0
+comparer_maj $TMP.s $TMP.d
+# rien n'a changé : aucune conversion
+$PROG -u $TMP.s $TMP.d > $TMP.out 2> $TMP.err \
+    || fail "code de retour != 0 (deuxième passe)"
+verifier_bilan $TMP.out 0 $nfic 0
+# une source modifiée, une source supprimée, une source ajoutée
+f=$(find $TMP.s/d1 -type f -print | head -1)
+echo "ligne ajoutee" >> "$f"
+rm "$TMP.s/d2/$(ls $TMP.s/d2 | grep -v '^d2' | head -1)"
+echo "nouveau fichier" > $TMP.s/d1/nouveau
+$PROG -u $TMP.s $TMP.d > $TMP.out 2> $TMP.err \
+    || fail "code de retour != 0 (troisième passe)"
+verifier_bilan $TMP.out 2 $((nfic - 2)) 1
+comparer_maj $TMP.s $TMP.d
+echo OK
+
+annoncer_test 2.10 "mise à jour avec empreinte (-u -c)"
+nettoyer
+creer_petite_arbo $TMP.s
+nfic=$(find $TMP.s -type f -print | wc -l)
+$PROG -u -c $TMP.s $TMP.d > $TMP.out 2> $TMP.err \
+    || fail "code de retour != 0 (première passe)"
+verifier_bilan $TMP.out $nfic 0 0
+comparer_maj $TMP.s $TMP.d
+# même contenu mais date modifiée : l'empreinte évite la conversion
+sleep 1
+touch $TMP.s/*
+$PROG -u -c $TMP.s $TMP.d > $TMP.out 2> $TMP.err \
+    || fail "code de retour != 0 (source touchée)"
+verifier_bilan $TMP.out 0 $nfic 0
+# sans -c, la date suffit à provoquer la conversion
+touch $TMP.s/*
+$PROG -u $TMP.s $TMP.d > $TMP.out 2> $TMP.err \
+    || fail "code de retour != 0 (sans -c)"
+verifier_bilan $TMP.out $nfic 0 0
+comparer_maj $TMP.s $TMP.d
+echo OK
+
+annoncer_test 2.11 "archive tar (-t)"
+nettoyer
+$PROG -z $TMP.s arbo > $TMP.out 2> $TMP.err && fail "-z sans -t accepté"
+verifier_usage $TMP.err
+$PROG -u -t $TMP.tar $TMP.s arbo > $TMP.out 2> $TMP.err \
+    && fail "-u avec -t accepté"
+verifier_usage $TMP.err
+creer_grande_arbo $TMP.s
+$PROG -t $TMP.tar $TMP.s arbo > $TMP.out 2> $TMP.err \
+    || fail "code de retour != 0 (archive)"
+verifier_pas_de_sortie $TMP
+mkdir $TMP.x
+tar xf $TMP.tar -C $TMP.x || fail "archive $TMP.tar illisible"
+reproduire_et_comparer $TMP.s $TMP.x/arbo
+# archive sur la sortie standard
+rm -rf $TMP.x $TMP.x.att
+mkdir $TMP.x
+$PROG -t - $TMP.s arbo 2> $TMP.err | tar xf - -C $TMP.x \
+    || fail "archive sur la sortie standard illisible"
+est_vide $TMP.err || fail "rien ne devrait être affiché sur stderr"
+reproduire_et_comparer $TMP.s $TMP.x/arbo
+echo OK
+
+annoncer_test 2.12 "archive compressée (-t -z)"
+if ! command -v zstd > /dev/null
+then echo "OK (zstd absent, test ignoré)"
+else
+    nettoyer
+    creer_grande_arbo $TMP.s
+    $PROG -t $TMP.tar.zst -z $TMP.s arbo > $TMP.out 2> $TMP.err \
+	|| fail "code de retour != 0 (archive compressée)"
+    verifier_pas_de_sortie $TMP
+    mkdir $TMP.x
+    zstd -q -d -c $TMP.tar.zst | tar xf - -C $TMP.x \
+	|| fail "archive $TMP.tar.zst illisible"
+    reproduire_et_comparer $TMP.s $TMP.x/arbo
+    # même contenu que l'archive non compressée
+    $PROG -t $TMP.tar $TMP.s arbo > $TMP.out 2> $TMP.err \
+	|| fail "code de retour != 0 (archive)"
+    zstd -q -d -c $TMP.tar.zst | tar tf - | sort > $TMP.lz
+    tar tf $TMP.tar | sort > $TMP.l
+    cmp -s $TMP.l $TMP.lz || fail "contenus différents avec et sans -z"
+    echo OK
+fi
+
+annoncer_test 2.13 "mise à jour : fichiers étrangers à majus conservés"
+nettoyer
+creer_petite_arbo $TMP.s
+mkdir -p $TMP.s/sous/rep
+echo "abc" > $TMP.s/sous/rep/f
+# dst existe déjà, sans manifeste, avec des fichiers qui ne sont pas à nous
+mkdir -p $TMP.d/photos
+echo "garder" > $TMP.d/precieux
+echo "x" > $TMP.d/photos/img
+chmod 750 $TMP.d/photos
+$PROG -u $TMP.s $TMP.d > $TMP.out 2> $TMP.err \
+    || fail "code de retour != 0 (première passe)"
+nfic=$(find $TMP.s -type f -print | wc -l)
+verifier_bilan $TMP.out $nfic 0 0
+# une source supprimée : seules ses traces (fichier, répertoires vidés)
+# disparaissent
+rm -r $TMP.s/sous
+echo "y" > $TMP.d/photos/autre
+$PROG -u $TMP.s $TMP.d > $TMP.out 2> $TMP.err \
+    || fail "code de retour != 0 (deuxième passe)"
+verifier_bilan $TMP.out 0 $((nfic - 1)) 3
+[ -e $TMP.d/sous ] && fail "$TMP.d/sous devrait être supprimé"
+[ x"$(cat $TMP.d/precieux)" = xgarder ] || fail "$TMP.d/precieux modifié"
+[ -f $TMP.d/photos/img -a -f $TMP.d/photos/autre ] \
+    || fail "$TMP.d/photos modifié"
+verifier_permissions rwxr-x--- $TMP.d/photos
+echo OK
+
 ##############################################################################
 # Processus et parallélisme
 
@@ -305,6 +305,132 @@ verifier_nb_processus 12 $pid
 calculer_et_verifier_resultat $TMP.out "$X" "$Y"
 echo OK
 
+annoncer_test 2.9 "moteur à threads, 100 couples, 10 threads"
+X=$(seq 80 -1 -20)
+Y=$(seq -20 1 80)
+$PROG -t 10 $X $Y > $TMP.out 2> $TMP.err || fail "code de retour != 0"
+calculer_et_verifier_resultat $TMP.out "$X" "$Y"
+echo OK
+
+annoncer_test 2.10 "moteur à threads, plus de threads que de couples"
+$PROG -t 7 2 3 4 5 > $TMP.out 2> $TMP.err || fail "code de retour != 0"
+verifier_resultat $TMP.out 23
+echo OK
+
+annoncer_test 2.11 "transports tube, shm et threads (-m)"
+X=$(seq 80 -1 -20)
+Y=$(seq -20 1 80)
+for m in tube shm threads
+do
+    for c in 1 3 10
+    do
+	$PROG -m $m $c $X $Y > $TMP.out 2> $TMP.err \
+	    || fail "code de retour != 0 (-m $m, c=$c)"
+	calculer_et_verifier_resultat $TMP.out "$X" "$Y"
+    done
+done
+$PROG -m inconnu 2 2 3 > $TMP.out 2> $TMP.err && fail "-m inconnu accepté"
+verifier_usage $TMP.err
+echo OK
+
+annoncer_test 2.12 "opérations (-o)"
+X=$(seq -7 9)
+Y=$(seq 3 19)
+W=$(seq 20 -1 4)
+# résultats attendus, calculés par le Shell
+prod=0 pond=0 norme=0 i=1
+for xi in $X
+do
+    yi=$(echo "$Y" | sed -n "${i} { p ; q }")
+    wi=$(echo "$W" | sed -n "${i} { p ; q }")
+    prod=$((prod + xi*yi))
+    pond=$((pond + xi*yi*wi))
+    norme=$((norme + xi*xi))
+    i=$((i+1))
+done
+# histo : nombre de bits significatifs de |x| et effectif, par classe
+for xi in $X
+do
+    v=${xi#-} b=0
+    while [ $v != 0 ]
+    do b=$((b+1)) v=$((v/2))
+    done
+    echo $b
+done | sort -n | uniq -c | awk '{ print $2, $1 }' > $TMP.histo
+for m in tube shm threads
+do
+    for c in 1 4
+    do
+	$PROG -m $m -o produit $c $X $Y > $TMP.out 2> $TMP.err \
+	    || fail "code de retour != 0 (produit, -m $m, c=$c)"
+	verifier_resultat $TMP.out $prod
+	$PROG -m $m -o pondere $c $X $Y $W > $TMP.out 2> $TMP.err \
+	    || fail "code de retour != 0 (pondere, -m $m, c=$c)"
+	verifier_resultat $TMP.out $pond
+	$PROG -m $m -o norme2 $c $X > $TMP.out 2> $TMP.err \
+	    || fail "code de retour != 0 (norme2, -m $m, c=$c)"
+	verifier_resultat $TMP.out $norme
+	$PROG -m $m -o minmax $c $X > $TMP.out 2> $TMP.err \
+	    || fail "code de retour != 0 (minmax, -m $m, c=$c)"
+	verifier_resultat $TMP.out "-7 9"
+	$PROG -m $m -o histo $c $X > $TMP.out 2> $TMP.err \
+	    || fail "code de retour != 0 (histo, -m $m, c=$c)"
+	cmp -s $TMP.out $TMP.histo \
+	    || fail "histogramme incorrect (-m $m, c=$c), cf $TMP.histo"
+    done
+done
+$PROG -o inconnue 2 2 3 > $TMP.out 2> $TMP.err && fail "-o inconnue acceptée"
+verifier_usage $TMP.err
+# pondere : le nombre de valeurs doit être un multiple de 3
+$PROG -o pondere 2 1 2 3 4 > $TMP.out 2> $TMP.err \
+    && fail "pondere avec 4 valeurs accepté"
+verifier_usage $TMP.err
+echo OK
+
+annoncer_test 2.13 "nombre de processus automatique (auto)"
+X=$(seq 80 -1 -20)
+Y=$(seq -20 1 80)
+for m in tube shm threads
+do
+    PRODSCAL_CONF=$TMP.conf $PROG -m $m auto $X $Y > $TMP.out 2> $TMP.err \
+	|| fail "code de retour != 0 (-m $m, calibration)"
+    calculer_et_verifier_resultat $TMP.out "$X" "$Y"
+    # deuxième exécution : réglage relu dans le fichier
+    PRODSCAL_CONF=$TMP.conf $PROG -v -m $m auto $X $Y > $TMP.out 2> $TMP.err \
+	|| fail "code de retour != 0 (-m $m, réglage gardé)"
+    calculer_et_verifier_resultat $TMP.out "$X" "$Y"
+    grep -q "réglage gardé" $TMP.err || fail "réglage non relu (-m $m)"
+done
+[ $(wc -l < $TMP.conf) = 3 ] || fail "$TMP.conf devrait avoir 3 réglages"
+$PROG auto > $TMP.out 2> $TMP.err && fail "auto sans valeur accepté"
+verifier_usage $TMP.err
+# -1 n'est pas auto : c'est un nombre de processus invalide
+for c in -1 -2 0
+do
+    $PROG -- $c 2 3 > $TMP.out 2> $TMP.err && fail "c = $c accepté"
+    verifier_usage $TMP.err
+done
+echo OK
+
+annoncer_test 2.14 "fichier de réglages inaccessible ou invalide"
+X=$(seq 5 100)
+Y=$(seq 72 -1 -23)
+# le fichier de réglages n'est qu'un cache : le calcul doit aboutir
+PRODSCAL_CONF=$TMP.inexistant/conf $PROG auto $X $Y > $TMP.out 2> $TMP.err \
+    || fail "code de retour != 0 (répertoire inexistant)"
+verifier_resultat $TMP.out 49760
+est_vide $TMP.err || fail "rien ne devrait être affiché sur stderr sans -v"
+PRODSCAL_CONF=$TMP.inexistant/conf $PROG -v auto $X $Y > $TMP.out 2> $TMP.err \
+    || fail "code de retour != 0 (répertoire inexistant, -v)"
+verifier_resultat $TMP.out 49760
+grep -q "non gardé" $TMP.err || fail "pas d'avertissement avec -v"
+# clé démesurée dans le fichier : lecture bornée
+printf "%05000d 3 0\n" 0 > $TMP.conf
+PRODSCAL_CONF=$TMP.conf $PROG auto $X $Y > $TMP.out 2> $TMP.err \
+    || fail "code de retour != 0 (clé trop longue)"
+verifier_resultat $TMP.out 49760
+echo OK
+
 ##############################################################################
 # Gestion mémoire
 
@@ -331,6 +331,132 @@ $PROG 1 $TMP.poly 1 > $TMP.out 2> $TMP.err || fail "code de retour != 0"
 [ -f $TMP.poly ] && fail "fichier $TMP.poly non supprimé"
 echo OK
 
+annoncer_test 2.6 "évaluation native (Horner), 100 itérations"
+nettoyer
+$PROG -H 100 $TMP.poly 4 -3 2 -1 > $TMP.out 2> $TMP.err \
+			|| fail "code de retour != 0"
+verifier_resultat $TMP.out 100 4 -3 2 -1
+[ -f $TMP.poly ] && fail "fichier $TMP.poly non supprimé"
+echo OK
+
+annoncer_test 2.7 "évaluation native (Horner), degré 99"
+nettoyer
+$PROG -H 1 $TMP.poly $(seq 1 100) > $TMP.out 2> $TMP.err \
+			|| fail "code de retour != 0"
+verifier_resultat $TMP.out 1 $(seq 1 100)
+echo OK
+
+annoncer_test 2.8 "état en mémoire partagée (-m)"
+nettoyer
+$PROG -m 5 $TMP.poly 4 3 2 > $TMP.out 2> $TMP.err || fail "code de retour != 0"
+verifier_resultat $TMP.out 5 4 3 2
+$PROG -m -H 100 $TMP.poly 4 -3 2 -1 > $TMP.out 2> $TMP.err \
+			|| fail "code de retour != 0 (avec -H)"
+verifier_resultat $TMP.out 100 4 -3 2 -1
+[ -f $TMP.poly ] && fail "fichier $TMP.poly créé malgré -m"
+echo OK
+
+annoncer_test 2.9 "notification par eventfd et par futex"
+nettoyer
+for notif in eventfd "eventfd -m" futex "futex -s 100"
+do
+    $PROG -n $notif -H 20 $TMP.poly 4 -3 2 -1 > $TMP.out 2> $TMP.err \
+			|| fail "code de retour != 0 (-n $notif)"
+    verifier_resultat $TMP.out 20 4 -3 2 -1
+done
+$PROG -n eventfd 3 $TMP.poly 4 3 2 > $TMP.out 2> $TMP.err \
+			|| fail "code de retour != 0 (-n eventfd avec expr)"
+verifier_resultat $TMP.out 3 4 3 2
+echo OK
+
+annoncer_test 2.10 "évaluation en pipeline (-p)"
+nettoyer
+for prof in 1 3 8 200
+do
+    $PROG -p $prof 100 $TMP.poly 4 -3 2 -1 > $TMP.out 2> $TMP.err \
+			|| fail "code de retour != 0 (-p $prof)"
+    verifier_resultat $TMP.out 100 4 -3 2 -1
+done
+echo OK
+
+annoncer_test 2.11 "mécanismes de lancement de expr (LANCEMENT)"
+nettoyer
+for l in fork vfork spawn clone pool
+do
+    LANCEMENT=$l $PROG 5 $TMP.poly 4 -3 2 > $TMP.out 2> $TMP.err \
+			|| fail "code de retour != 0 (LANCEMENT=$l)"
+    verifier_resultat $TMP.out 5 4 -3 2
+done
+LANCEMENT=inconnu $PROG 1 $TMP.poly 1 > $TMP.out 2> $TMP.err \
+			&& fail "LANCEMENT=inconnu accepté"
+verifier_stderr $TMP
+echo OK
+
+annoncer_test 2.12 "différences finies (-d)"
+nettoyer
+$PROG -d 100 $TMP.poly 4 -3 2 -1 > $TMP.out 2> $TMP.err \
+			|| fail "code de retour != 0 (degré 3)"
+verifier_resultat $TMP.out 100 4 -3 2 -1
+$PROG -d 5 $TMP.poly 7 > $TMP.out 2> $TMP.err \
+			|| fail "code de retour != 0 (degré 0)"
+verifier_resultat $TMP.out 5 7
+$PROG -d 3 $TMP.poly -1 1 -1 1 -1 1 -1 1 > $TMP.out 2> $TMP.err \
+			|| fail "code de retour != 0 (k < degré)"
+verifier_resultat $TMP.out 3 -1 1 -1 1 -1 1 -1 1
+# degré 20 : p(9) déborde, mais seuls p(1) et p(2) sont demandés
+$PROG -d 2 $TMP.poly $(seq 1 21 | sed 's/.*/1/') > $TMP.out 2> $TMP.err \
+			|| fail "code de retour != 0 (k = 2, degré 20)"
+verifier_resultat $TMP.out 2 $(seq 1 21 | sed 's/.*/1/')
+# p(x) doit tenir sur un int, comme avec -H : mêmes valeurs, même erreur
+$PROG -H -m 1300 $TMP.poly 0 0 0 1 > $TMP.out.H 2> $TMP.err \
+			&& fail "dépassement non détecté (-H -m)"
+$PROG -d 1300 $TMP.poly 0 0 0 1 > $TMP.out 2> $TMP.err \
+			&& fail "dépassement non détecté (-d)"
+cmp -s $TMP.out $TMP.out.H || fail "valeurs différentes de -H -m avant x = 1291"
+for opt in "-p 2" "-b 4"
+do
+    $PROG -d $opt 5 $TMP.poly 1 2 > $TMP.out 2> $TMP.err \
+			&& fail "-d $opt accepté"
+    verifier_usage $TMP.err
+done
+echo OK
+
+annoncer_test 2.13 "évaluation par lots (-b)"
+nettoyer
+for lot in 1 3 8 9 16 100 4096
+do
+    $PROG -b $lot 100 $TMP.poly 4 -3 2 -1 > $TMP.out 2> $TMP.err \
+			|| fail "code de retour != 0 (-b $lot)"
+    verifier_resultat $TMP.out 100 4 -3 2 -1
+done
+for lot in 0 -1 4097 99999999999
+do
+    $PROG -b $lot 5 $TMP.poly 1 2 > $TMP.out 2> $TMP.err \
+			&& fail "-b $lot accepté"
+    verifier_usage $TMP.err
+done
+# dépassement : le lot fautif (x = 1281 ... 1296) n'est pas affiché
+$PROG -b 16 1300 $TMP.poly 0 0 0 1 > $TMP.out 2> $TMP.err \
+			&& fail "dépassement non détecté (-b 16)"
+[ $(wc -l < $TMP.out) = 1280 ] \
+			|| fail "$(wc -l < $TMP.out) valeurs au lieu de 1280"
+verifier_resultat $TMP.out 1280 0 0 0 1
+echo OK
+
+annoncer_test 2.14 "Horner : produit intermédiaire hors des int"
+nettoyer
+# p(2) = -2^30 + 2^30 * 2 tient sur un int, mais pas 2^30 * 2
+$PROG 2 $TMP.poly -1073741824 1073741824 > $TMP.out 2> $TMP.err \
+			|| fail "code de retour != 0 (expr)"
+verifier_resultat $TMP.out 2 -1073741824 1073741824
+for opt in "-H" "-H -m" "-p 2" "-b 1" "-b 8"
+do
+    $PROG $opt 2 $TMP.poly -1073741824 1073741824 > $TMP.out 2> $TMP.err \
+			|| fail "code de retour != 0 ($opt)"
+    verifier_resultat $TMP.out 2 -1073741824 1073741824
+done
+echo OK
+
 ##############################################################################
 # Fonctionnalités plus avancées
 
@@ -0,0 +1,128 @@
+#!/bin/sh
+
+PROG=${PROG:=./bench_collectif}		# chemin de l'exécutable
+
+TMP=${TMP:=/tmp/test}			# chemin des logs de test
+
+#
+# Script Shell de test de la bibliothèque collectif (par bench_collectif,
+# qui vérifie le résultat de chaque collective avant de la chronométrer)
+# Utilisation : sh ./test_collectif.sh
+#
+# Si tout se passe bien, le script doit afficher "Tests ok" à la fin
+# Dans le cas contraire, le nom du test échoué s'affiche.
+# Les fichiers sont laissés dans /tmp/test* en cas d'échec, vous
+# pouvez les examiner.
+# Pour avoir plus de détails sur l'exécution du script, vous pouvez
+# utiliser :
+#	sh -x ./test_collectif.sh
+# Toutes les commandes exécutées par le script sont alors affichées
+# et vous pouvez les exécuter séparément.
+#
+
+set -u					# erreur si variable non définie
+
+# il ne faudrait jamais appeler cette fonction
+# argument : message d'erreur
+fail ()
+{
+    local msg="$1"
+
+    echo FAIL				# aie aie aie...
+    echo "$msg"
+    echo "Voir les fichiers suivants :"
+    ls -dp $TMP*
+    exit 1
+}
+
+# longueur (en nb de caractères, pas d'octets) d'une chaîne UTF-8
+strlen ()
+{
+    [ $# != 1 ] && fail "ERREUR SYNTAXE strlen"
+    local str="$1"
+    printf "%s" "$str" | wc -m
+}
+
+# Annonce un test
+# $1 = numéro du test
+# $2 = intitulé
+annoncer_test ()
+{
+    [ $# != 2 ] && fail "ERREUR SYNTAXE annoncer_test"
+    local num="$1" msg="$2"
+    local debut nbcar nbtirets
+
+    debut="Test $num - $msg"
+    nbcar=$(strlen "$debut")
+    nbtirets=$((80 - 6 - nbcar))
+    printf "%s%-${nbtirets}.${nbtirets}s " "$debut" \
+	"...................................................................."
+}
+
+# Teste si le fichier est vide (ne fait que tester, pas d'erreur renvoyée)
+est_vide ()
+{
+    [ $# != 1 ] && fail "ERREUR SYNTAXE est_vide"
+    local fichier="$1"
+    test $(wc -l < "$fichier") = 0
+}
+
+# Vérifie que le message d'erreur indique la bonne syntaxe
+# $1 = nom du fichier de log d'erreur
+verifier_usage ()
+{
+    [ $# != 1 ] && fail "ERREUR SYNTAXE verifier_usage"
+    local err="$1"
+    grep -q "usage *: " $err \
+	|| fail "Message d'erreur devrait indiquer 'usage:...'"
+}
+
+# Supprimer les fichiers restant d'une précédente exécution
+nettoyer ()
+{
+    rm -rf $TMP*
+}
+
+nettoyer
+
+##############################################################################
+# Vérification des arguments
+
+annoncer_test 1.1 "argument en trop"
+$PROG 3 > $TMP.out 2> $TMP.err && fail "argument en trop"
+verifier_usage $TMP.err
+echo OK
+
+annoncer_test 1.2 "nb de processus invalide"
+$PROG -n 0 > $TMP.out 2> $TMP.err && fail "-n 0"
+verifier_usage $TMP.err
+echo OK
+
+##############################################################################
+# Résultats des collectives, pour tous les algorithmes : les tailles vont
+# jusqu'à plusieurs segments, et les nombres de processus couvrent les
+# puissances de 2 et les autres (arbres incomplets, variante de Bruck)
+
+num=1
+for n in 1 2 3 5 8
+do
+    annoncer_test 2.$num "toutes les collectives, $n processus"
+    $PROG -n $n -i 1 -t 65536 > $TMP.out 2> $TMP.err \
+	|| fail "code de retour != 0"
+    est_vide $TMP.err || fail "rien ne devrait être affiché sur stderr"
+    for col in barriere decaler diffuser reduire collecter echange_total
+    do
+	grep -q "^$col	" $TMP.out || fail "$col absente"
+    done
+    echo OK
+    num=$((num + 1))
+done
+
+annoncer_test 2.$num "attente active avant futex (-s)"
+$PROG -n 4 -i 1 -t 8192 -s 100 > $TMP.out 2> $TMP.err \
+    || fail "code de retour != 0"
+echo OK
+
+nettoyer
+echo "Tests ok"
+exit 0
@@ -0,0 +1,182 @@
+#!/bin/sh
+
+PROG=${PROG:=./rondeur}			# chemin de l'exécutable
+
+TMP=${TMP:=/tmp/test}			# chemin des logs de test
+
+#
+# Script Shell de test de rondeur (version corrigée de ronde.c)
+# Utilisation : sh ./test_ronde.sh
+#
+# Si tout se passe bien, le script doit afficher "Tests ok" à la fin
+# Dans le cas contraire, le nom du test échoué s'affiche.
+# Les fichiers sont laissés dans /tmp/test* en cas d'échec, vous
+# pouvez les examiner.
+# Pour avoir plus de détails sur l'exécution du script, vous pouvez
+# utiliser :
+#	sh -x ./test_ronde.sh
+# Toutes les commandes exécutées par le script sont alors affichées
+# et vous pouvez les exécuter séparément.
+#
+
+set -u					# erreur si variable non définie
+
+# il ne faudrait jamais appeler cette fonction
+# argument : message d'erreur
+fail ()
+{
+    local msg="$1"
+
+    echo FAIL				# aie aie aie...
+    echo "$msg"
+    echo "Voir les fichiers suivants :"
+    ls -dp $TMP*
+    exit 1
+}
+
+# longueur (en nb de caractères, pas d'octets) d'une chaîne UTF-8
+strlen ()
+{
+    [ $# != 1 ] && fail "ERREUR SYNTAXE strlen"
+    local str="$1"
+    printf "%s" "$str" | wc -m
+}
+
+# Annonce un test
+# $1 = numéro du test
+# $2 = intitulé
+annoncer_test ()
+{
+    [ $# != 2 ] && fail "ERREUR SYNTAXE annoncer_test"
+    local num="$1" msg="$2"
+    local debut nbcar nbtirets
+
+    debut="Test $num - $msg"
+    nbcar=$(strlen "$debut")
+    nbtirets=$((80 - 6 - nbcar))
+    printf "%s%-${nbtirets}.${nbtirets}s " "$debut" \
+	"...................................................................."
+}
+
+# Teste si le fichier est vide (ne fait que tester, pas d'erreur renvoyée)
+est_vide ()
+{
+    [ $# != 1 ] && fail "ERREUR SYNTAXE est_vide"
+    local fichier="$1"
+    test $(wc -l < "$fichier") = 0
+}
+
+# Vérifie que le message d'erreur indique la bonne syntaxe
+# $1 = nom du fichier de log d'erreur
+verifier_usage ()
+{
+    [ $# != 1 ] && fail "ERREUR SYNTAXE verifier_usage"
+    local err="$1"
+    grep -q "usage *: " $err \
+	|| fail "Message d'erreur devrait indiquer 'usage:...'"
+}
+
+# Vérifie que chaque valeur a été reçue une fois, dans un ordre quelconque
+# $1 = fichier de sortie
+# $2 et suivants = valeurs transmises
+verifier_ronde ()
+{
+    [ $# -lt 2 ] && fail "ERREUR SYNTAXE verifier_ronde"
+    local out="$1"
+    shift
+
+    for v
+    do
+	echo $v
+    done | sort -n > $TMP.att
+    sort -n "$out" > $TMP.tri
+    cmp -s $TMP.tri $TMP.att || fail "valeurs reçues != transmises (cf $TMP.*)"
+}
+
+# Supprimer les fichiers restant d'une précédente exécution
+nettoyer ()
+{
+    rm -rf $TMP*
+}
+
+nettoyer
+
+##############################################################################
+# Vérification des arguments
+
+annoncer_test 1.1 "nombre d'arguments invalide"
+$PROG > $TMP.out 2> $TMP.err && fail "pas d'argument"
+verifier_usage $TMP.err
+est_vide $TMP.out || fail "rien ne devrait être affiché sur stdout"
+echo OK
+
+annoncer_test 1.2 "aucune valeur"
+$PROG -m $TMP.ronde > $TMP.out 2> $TMP.err && fail "pas de valeur"
+verifier_usage $TMP.err
+echo OK
+
+annoncer_test 1.3 "démarrage inconnu"
+$PROG -d tous $TMP.ronde 1 2 > $TMP.out 2> $TMP.err && fail "-d tous"
+verifier_usage $TMP.err
+echo OK
+
+##############################################################################
+# Échange des valeurs
+
+V=$(seq 1 20)
+
+annoncer_test 2.1 "échange par fichier"
+$PROG $TMP.ronde $V > $TMP.out 2> $TMP.err || fail "code de retour != 0"
+verifier_ronde $TMP.out $V
+[ -e $TMP.ronde ] && fail "le fichier devrait être supprimé"
+echo OK
+
+annoncer_test 2.2 "échange par mémoire partagée (-m)"
+$PROG -m $TMP.ronde $V > $TMP.out 2> $TMP.err || fail "code de retour != 0"
+verifier_ronde $TMP.out $V
+echo OK
+
+annoncer_test 2.3 "mémoire partagée, un seul processus"
+$PROG -m $TMP.ronde 42 > $TMP.out 2> $TMP.err || fail "code de retour != 0"
+verifier_ronde $TMP.out 42
+echo OK
+
+V=$(seq -100 3 500)
+annoncer_test 2.4 "mémoire partagée, 201 processus"
+$PROG -m $TMP.ronde $V > $TMP.out 2> $TMP.err || fail "code de retour != 0"
+verifier_ronde $TMP.out $V
+echo OK
+
+##############################################################################
+# Démarrage et fin du tour (-d)
+
+V=$(seq 1 50)
+num=1
+for d in kill groupe barriere
+do
+    for m in "" -m
+    do
+	[ $d = barriere -a -z "$m" ] && continue  # barriere impose -m
+	annoncer_test 3.$num "démarrage $d $m"
+	$PROG $m -d $d $TMP.ronde $V > $TMP.out 2> $TMP.err 	    || fail "code de retour != 0"
+	verifier_ronde $TMP.out $V
+	echo OK
+	num=$((num + 1))
+    done
+done
+
+# le père vérifie qu'aucune case n'est vide quand il franchit la
+# barrière de fin : la mesure couvre bien tous les échanges
+V=$(seq 1 200)
+annoncer_test 3.$num "la barrière de fin couvre tout le tour"
+for i in $(seq 1 10)
+do
+    $PROG -d barriere -t $TMP.ronde $V > $TMP.out 2> $TMP.err 	|| fail "code de retour != 0 (essai $i)"
+    verifier_ronde $TMP.out $V
+    grep -q "^200 processus, tour en [0-9]* ns$" $TMP.err 	|| fail "durée du tour absente (essai $i)"
+done
+echo OK
+
+nettoyer
+echo "Tests ok"
+exit 0
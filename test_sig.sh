@@ -0,0 +1,276 @@
+#!/bin/sh
+
+PROG=${PROG:=./sig}				# chemin de l'exécutable
+
+TMP=${TMP:=/tmp/test}			# chemin des logs de test
+
+#
+# Script Shell de test des modes de mesure de sig
+# Utilisation : sh ./test_sig.sh
+#
+# Si tout se passe bien, le script doit afficher "Tests ok" à la fin
+# Dans le cas contraire, le nom du test échoué s'affiche.
+# Les fichiers sont laissés dans /tmp/test* en cas d'échec, vous
+# pouvez les examiner.
+# Pour avoir plus de détails sur l'exécution du script, vous pouvez
+# utiliser :
+#	sh -x ./test_sig.sh
+# Toutes les commandes exécutées par le script sont alors affichées
+# et vous pouvez les exécuter séparément.
+#
+
+set -u					# erreur si variable non définie
+
+# il ne faudrait jamais appeler cette fonction
+# argument : message d'erreur
+fail ()
+{
+    local msg="$1"
+
+    echo FAIL				# aie aie aie...
+    echo "$msg"
+    echo "Voir les fichiers suivants :"
+    ls -dp $TMP*
+    exit 1
+}
+
+# longueur (en nb de caractères, pas d'octets) d'une chaîne UTF-8
+strlen ()
+{
+    [ $# != 1 ] && fail "ERREUR SYNTAXE strlen"
+    local str="$1"
+    printf "%s" "$str" | wc -m
+}
+
+# Annonce un test
+# $1 = numéro du test
+# $2 = intitulé
+annoncer_test ()
+{
+    [ $# != 2 ] && fail "ERREUR SYNTAXE annoncer_test"
+    local num="$1" msg="$2"
+    local debut nbcar nbtirets
+
+    debut="Test $num - $msg"
+    nbcar=$(strlen "$debut")
+    nbtirets=$((80 - 6 - nbcar))
+    printf "%s%-${nbtirets}.${nbtirets}s " "$debut" \
+	"...................................................................."
+}
+
+# Teste si le fichier est vide (ne fait que tester, pas d'erreur renvoyée)
+est_vide ()
+{
+    [ $# != 1 ] && fail "ERREUR SYNTAXE est_vide"
+    local fichier="$1"
+    test $(wc -l < "$fichier") = 0
+}
+
+# Vérifie que le message d'erreur indique la bonne syntaxe
+# $1 = nom du fichier de log d'erreur
+verifier_usage ()
+{
+    [ $# != 1 ] && fail "ERREUR SYNTAXE verifier_usage"
+    local err="$1"
+    grep -q "usage *: " $err \
+	|| fail "Message d'erreur devrait indiquer 'usage:...'"
+}
+
+# Vérifie que les mécanismes indiqués, et eux seuls, ont été mesurés
+# $1 = fichier de sortie
+# $2 et suivants = mécanismes attendus
+verifier_mecanismes ()
+{
+    [ $# -lt 2 ] && fail "ERREUR SYNTAXE verifier_mecanismes"
+    local out="$1" m
+    shift
+
+    head -1 "$out" | grep -q "^mecanisme	octets	iter	latence_ns" \
+	|| fail "en-tête du tableau absent"
+    for m
+    do
+	grep -q "^$m	" "$out" || fail "mécanisme $m absent"
+    done
+    [ $(sed 1d "$out" | cut -f1 | sort -u | wc -l) = $# ] \
+	|| fail "mécanismes non demandés mesurés"
+}
+
+# Vérifie le bilan du comptage (-q) : aucun signal perdu ni fusionné
+# $1 = fichier de sortie
+# $2 = nb d'émetteurs
+# $3 = nb de récepteurs
+verifier_comptage ()
+{
+    [ $# != 3 ] && fail "ERREUR SYNTAXE verifier_comptage"
+    local out="$1" s="$2" r="$3"
+    local emis recus
+
+    emis=$(sed -n "s/^émetteurs : $s, émis = \([0-9]*\),.*/\1/p" "$out")
+    recus=$(sed -n "s/^récepteurs : $r, reçus = \([0-9]*\),.*/\1/p" "$out")
+    [ -n "$emis" ] || fail "bilan des émetteurs absent"
+    [ -n "$recus" ] || fail "bilan des récepteurs absent"
+    [ "$emis" -gt 0 ] || fail "aucun signal émis"
+    [ "$emis" = "$recus" ] || fail "émis ($emis) != reçus ($recus)"
+    grep -q "fusionnés = 0, hors ordre = 0," "$out" \
+	|| fail "signaux fusionnés ou hors ordre"
+    [ $(grep -c "^récepteur [0-9]* (cpu [0-9]*) : reçus = " "$out") = $r ] \
+	|| fail "bilan de chaque récepteur absent"
+}
+
+# Vérifie que les quantiles de latence sont présents et croissants
+# $1 = fichier de sortie
+verifier_latences ()
+{
+    [ $# != 1 ] && fail "ERREUR SYNTAXE verifier_latences"
+    local out="$1"
+    local l
+
+    l=$(sed -n 's/^latence (ns) p50 = \([0-9]*\), p99 = \([0-9]*\), p99.9 = \([0-9]*\), max = \([0-9]*\)$/\1 \2 \3 \4/p' "$out")
+    [ -n "$l" ] || fail "histogramme des latences absent"
+    set -- $l
+    [ $1 -le $2 -a $2 -le $3 -a $3 -le $4 ] \
+	|| fail "quantiles de latence non croissants ($l)"
+}
+
+# Supprimer les fichiers restant d'une précédente exécution
+nettoyer ()
+{
+    rm -rf $TMP*
+}
+
+nettoyer
+
+##############################################################################
+# Banc d'essai des mécanismes de communication (-b)
+
+annoncer_test 1.1 "banc d'essai : argument en trop"
+$PROG -b 3 > $TMP.out 2> $TMP.err && fail "argument en trop"
+verifier_usage $TMP.err
+echo OK
+
+annoncer_test 1.2 "banc d'essai : mécanisme inconnu"
+$PROG -b -m pipe,tamtam > $TMP.out 2> $TMP.err && fail "-m tamtam"
+est_vide $TMP.err && fail "message d'erreur devrait être sur stderr"
+echo OK
+
+annoncer_test 1.3 "banc d'essai : taille invalide"
+$PROG -b -T 999999999 > $TMP.out 2> $TMP.err && fail "-T trop grand"
+verifier_usage $TMP.err
+echo OK
+
+annoncer_test 1.4 "banc d'essai, tous les mécanismes"
+$PROG -b -n 20 -T 64 > $TMP.out 2> $TMP.err || fail "code de retour != 0"
+verifier_mecanismes $TMP.out signal sigqueue signalfd pipe socket eventfd \
+    mqueue futex
+echo OK
+
+annoncer_test 1.5 "banc d'essai, mécanismes choisis"
+$PROG -b -n 20 -T 4096 -m pipe,futex > $TMP.out 2> $TMP.err \
+    || fail "code de retour != 0"
+verifier_mecanismes $TMP.out pipe futex
+grep -q "^pipe	4096	" $TMP.out || fail "taille 4096 non mesurée"
+echo OK
+
+##############################################################################
+# Comptage sans perte des signaux temps réel (-q)
+
+annoncer_test 2.1 "comptage : signal au-delà de SIGRTMAX"
+$PROG -q -k 1000 1 > $TMP.out 2> $TMP.err && fail "-k 1000"
+est_vide $TMP.err && fail "message d'erreur devrait être sur stderr"
+echo OK
+
+annoncer_test 2.2 "comptage, un émetteur et un récepteur"
+$PROG -q 1 > $TMP.out 2> $TMP.err || fail "code de retour != 0"
+verifier_comptage $TMP.out 1 1
+echo OK
+
+annoncer_test 2.3 "comptage, autre signal et émission cadencée"
+$PROG -q -k 3 -i 100 1 > $TMP.out 2> $TMP.err || fail "code de retour != 0"
+verifier_comptage $TMP.out 1 1
+echo OK
+
+##############################################################################
+# Durées en fractions de seconde et histogramme des latences
+
+num=1
+for d in "" abc -1 1s 0 1e-10 inf nan 1e30
+do
+    annoncer_test 3.$num "durée invalide ('$d')"
+    # une durée nulle une fois convertie désarmerait le timer : sans
+    # timeout, le mode d'origine ne s'arrêterait jamais
+    for opt in -q ""
+    do
+	timeout 5 $PROG $opt $d > $TMP.out 2> $TMP.err \
+	    && fail "durée '$d' acceptée ($opt)"
+	[ $? = 124 ] && fail "durée '$d' : pas de fin ($opt)"
+	est_vide $TMP.err && fail "message d'erreur devrait être sur stderr"
+    done
+    echo OK
+    num=$((num + 1))
+done
+
+annoncer_test 3.$num "fraction de seconde, mode d'origine"
+$PROG 0.2 > $TMP.out 2> $TMP.err || fail "code de retour != 0"
+grep -q "^pere : nb signaux emis = " $TMP.out || fail "bilan du père absent"
+echo OK
+num=$((num + 1))
+
+annoncer_test 3.$num "histogramme des latences"
+$PROG -q 0.3 > $TMP.out 2> $TMP.err || fail "code de retour != 0"
+verifier_comptage $TMP.out 1 1
+verifier_latences $TMP.out
+echo OK
+
+##############################################################################
+# Plusieurs émetteurs et récepteurs, placement sur les processeurs (-c)
+
+annoncer_test 4.1 "nb d'émetteurs ou de récepteurs invalide"
+$PROG -q -s 0 1 > $TMP.out 2> $TMP.err && fail "-s 0"
+verifier_usage $TMP.err
+$PROG -q -r -2 1 > $TMP.out 2> $TMP.err && fail "-r -2"
+verifier_usage $TMP.err
+echo OK
+
+annoncer_test 4.2 "placement inconnu"
+$PROG -q -c ailleurs 1 > $TMP.out 2> $TMP.err && fail "-c ailleurs"
+est_vide $TMP.err && fail "message d'erreur devrait être sur stderr"
+echo OK
+
+annoncer_test 4.3 "3 émetteurs et 2 récepteurs"
+$PROG -q -s 3 -r 2 0.5 > $TMP.out 2> $TMP.err || fail "code de retour != 0"
+verifier_comptage $TMP.out 3 2
+echo OK
+
+annoncer_test 4.4 "tous sur le même processeur"
+$PROG -q -s 2 -r 2 -c meme 0.5 > $TMP.out 2> $TMP.err \
+    || fail "code de retour != 0"
+verifier_comptage $TMP.out 2 2
+c0=$(sed -n 's/^récepteur 0 (cpu \([0-9]*\)).*/\1/p' $TMP.out)
+[ $(grep -c "^récepteur [0-9]* (cpu $c0)" $TMP.out) = 2 ] \
+    || fail "récepteurs sur des processeurs différents"
+echo OK
+
+# émetteurs sur la première moitié de la liste, récepteurs sur le reste
+cpus=$(sed -n 's/^Cpus_allowed_list:[[:space:]]*//p' /proc/self/status \
+	| tr ',-' '  ')
+set -- $cpus
+annoncer_test 4.5 "liste de processeurs partagée"
+if [ $# -ge 2 ]
+then
+    $PROG -q -s 2 -r 2 -c $1,$2 0.5 > $TMP.out 2> $TMP.err \
+	|| fail "code de retour != 0"
+    verifier_comptage $TMP.out 2 2
+    [ $(grep -c "^récepteur [0-9]* (cpu $2)" $TMP.out) = 2 ] \
+	|| fail "récepteurs hors du processeur $2"
+else
+    $PROG -q -s 2 -r 2 -c $1 0.5 > $TMP.out 2> $TMP.err \
+	|| fail "code de retour != 0"
+    verifier_comptage $TMP.out 2 2
+    [ $(grep -c "^récepteur [0-9]* (cpu $1)" $TMP.out) = 2 ] \
+	|| fail "récepteurs hors du processeur $1"
+fi
+echo OK
+
+nettoyer
+echo "Tests ok"
+exit 0